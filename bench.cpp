@@ -0,0 +1,809 @@
+#include "ramnet.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <new>
+
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <tls.h>
+#include <unistd.h>
+
+using namespace ramnet;
+
+// usage: ./bench [output.json] [filter]
+// every benchmark prints a line as it finishes, and the whole run is written out as json at the end
+// so two runs can be diffed. the filter only runs benchmarks whose "group name" contains it.
+
+// every allocation goes through here, the ones made inside libramnet.so included, so we can count them per op.
+// the deletes stay out of line, gcc warns about new paired with free() once it can see both.
+// some benchmarks allocate on worker threads, so the count is atomic. relaxed is enough, it is only read between runs.
+std::atomic<size_t> allocations(0);
+
+void *operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void *p = malloc(size == 0 ? 1 : size);
+	if(p == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+#if __cplusplus >= 201402L
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
+#endif
+
+// base64.cpp is still built into the library, these are its own entry points
+std::string base64_encode(std::string const &s, bool url);
+std::string base64_decode(std::string const &s, bool remove_linebreaks);
+std::string base64_encode_pem(std::string const &s);
+
+// the implementations these replaced, kept here so every run shows what we gained.
+namespace legacy {
+
+std::string strtoupper(const std::string &str)
+{
+	std::string result = str;
+	std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c){ return std::toupper(c); });
+	return result;
+}
+
+std::string strtolower(const std::string &str)
+{
+	std::string result = str;
+	std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c){ return std::tolower(c); });
+	return result;
+}
+
+std::string str_rot13(const std::string &str)
+{
+	std::string result;
+	for(size_t i = 0; i < str.size(); i++)
+	{
+		if(isalpha(str[i]))
+		{
+			if((tolower(str[i]) - 'a') < 14)
+			{
+				result.append(1, str[i] + 13);
+			}
+			else
+			{
+				result.append(1, str[i] - 13);
+			}
+		}
+		else
+		{
+			result.append(1, str[i]);
+		}
+	}
+	return result;
+}
+
+// the usual hand written encoder, what callers building query strings had before urlencode()
+std::string urlencode(const std::string &str)
+{
+	std::ostringstream out;
+	out << std::hex << std::uppercase;
+	for(size_t i = 0; i < str.size(); i++)
+	{
+		unsigned char c = str[i];
+		if(isalnum(c) || c == '-' || c == '_' || c == '.')
+		{
+			out << c;
+		}
+		else if(c == ' ')
+		{
+			out << '+';
+		}
+		else
+		{
+			out << '%' << std::setw(2) << std::setfill('0') << (int)c;
+		}
+	}
+	return out.str();
+}
+
+// ssl_sopen() and ssl_close() as they were, with a new config per connection so there is no session to resume
+size_t ssl_sopen_close(const std::string &hostname, int port, const std::string &ca_file)
+{
+	int sock = sopen(hostname, port);
+	struct tls_config *config = tls_config_new();
+	struct tls *ctx = tls_client();
+	size_t ok = 0;
+	if(sock != -1 && config != NULL && ctx != NULL && tls_config_set_ca_file(config, ca_file.c_str()) == 0
+	&& tls_configure(ctx, config) == 0 && tls_connect_socket(ctx, sock, hostname.c_str()) == 0 && tls_handshake(ctx) == 0)
+	{
+		ok = 1;
+		tls_close(ctx);
+	}
+	tls_free(ctx);
+	tls_config_free(config);
+	ramnet::close(sock);
+	return ok;
+}
+
+} // end namespace legacy
+
+struct bench_result
+{
+	std::string group;
+	std::string name;
+	size_t bytes;
+	size_t iterations;
+	double ns_per_op;
+	double allocs_per_op;
+};
+
+std::vector<bench_result> results;
+std::string filter;
+
+// keeps the optimizer from throwing away results we never look at
+volatile size_t sink;
+
+// the same text at three sizes: a header value, a page, and a megabyte
+std::vector<std::string> inputs()
+{
+	const std::string text = "The Quick Brown Fox Jumps Over The Lazy Dog. ";
+	return { text, str_repeat(text, 100), str_repeat(text, 25000) };
+}
+
+// runs fn until at least a fifth of a second has gone by. bytes is how much input one call handles,
+// zero when throughput makes no sense for the function.
+// the clock is only read between batches, and batches double, so it costs nothing on the tiny ops.
+template <typename Fn>
+void bench(const std::string &group, const std::string &name, size_t bytes, Fn fn)
+{
+	if(filter != "" && str_contains(group + " " + name, filter) == false)
+	{
+		return;
+	}
+
+	// the first call pays for one time setup (kernel dispatch, tables, dns), keep it out of the numbers
+	sink = sink + fn();
+
+	size_t iterations = 0;
+	size_t batch = 1;
+	size_t allocated = allocations.load(std::memory_order_relaxed);
+	auto start = std::chrono::steady_clock::now();
+	auto now = start;
+	while(now - start < std::chrono::milliseconds(200))
+	{
+		for(size_t i = 0; i < batch; i++)
+		{
+			sink = sink + fn();
+		}
+		iterations = iterations + batch;
+		batch = batch * 2;
+		now = std::chrono::steady_clock::now();
+	}
+	allocated = allocations.load(std::memory_order_relaxed) - allocated;
+
+	bench_result r;
+	r.group = group;
+	r.name = name;
+	r.bytes = bytes;
+	r.iterations = iterations;
+	r.ns_per_op = std::chrono::duration<double, std::nano>(now - start).count() / iterations;
+	r.allocs_per_op = (double)allocated / iterations;
+	results.push_back(r);
+
+	std::string line = str_format("%-11s%-36s%10u B %14.1f ns/op", group, name, bytes, r.ns_per_op);
+	if(bytes > 0)
+	{
+		str_format_append(line, " %10.1f MB/s", bytes * 1e3 / r.ns_per_op);
+	}
+	else
+	{
+		line.append(16, ' ');
+	}
+	str_format_append(line, " %8.2f allocs/op", r.allocs_per_op);
+	std::cout << line << std::endl;
+}
+
+void bench_string()
+{
+	for(const std::string &input : inputs())
+	{
+		size_t n = input.size();
+		std::string padded = "  \t" + input + "\r\n";
+		bench("string", "ltrim()", n, [&]() { return ltrim(padded).size(); });
+		bench("string", "rtrim()", n, [&]() { return rtrim(padded).size(); });
+		bench("string", "trim()", n, [&]() { return trim(padded).size(); });
+
+		// a needle that is never found, so every search walks the whole input
+		str_needle needle = str_needle_compile("Lazy Cat");
+		bench("string", "str_contains()", n, [&]() { return (size_t)str_contains(input, "Lazy Cat"); });
+		bench("string", "strpos()", n, [&]() { return strpos(input, "Lazy Cat"); });
+		bench("string", "strpos() compiled", n, [&]() { return strpos(input, needle); });
+		bench("string", "stripos()", n, [&]() { return stripos(input, "LAZY CAT"); });
+		bench("string", "strrpos()", n, [&]() { return strrpos(input, "Lazy Cat"); });
+		bench("string", "substr_count()", n, [&]() { return substr_count(input, "Fox"); });
+
+		bench("string", "strrev()", n, [&]() { return strrev(input).size(); });
+		bench("string", "str_repeat() x4", n * 4, [&]() { return str_repeat(input, 4).size(); });
+		bench("string", "str_pad()", n * 2, [&]() { return str_pad(input, n * 2, "-=", STR_PAD_BOTH).size(); });
+
+		bench("string", "legacy strtoupper()", n, [&]() { return legacy::strtoupper(input).size(); });
+		bench("string", "strtoupper()", n, [&]() { return strtoupper(input).size(); });
+		bench("string", "legacy strtolower()", n, [&]() { return legacy::strtolower(input).size(); });
+		bench("string", "strtolower()", n, [&]() { return strtolower(input).size(); });
+		bench("string", "legacy str_rot13()", n, [&]() { return legacy::str_rot13(input).size(); });
+		bench("string", "str_rot13()", n, [&]() { return str_rot13(input).size(); });
+		bench("string", "ucfirst()", n, [&]() { return ucfirst(input).size(); });
+		bench("string", "lcfirst()", n, [&]() { return lcfirst(input).size(); });
+
+		std::string buf = input;
+		bench("string", "strtoupper_inplace()", n, [&]() { strtoupper_inplace(buf); return buf.size(); });
+		bench("string", "strtolower_inplace()", n, [&]() { strtolower_inplace(buf); return buf.size(); });
+		bench("string", "str_rot13_inplace()", n, [&]() { str_rot13_inplace(buf); return buf.size(); });
+
+		std::vector<std::string> search = { "Fox", "Dog", "Quick" };
+		std::vector<std::string> replace = { "Cat", "Cow", "Slow" };
+		strtr_table table = strtr_compile(search, replace);
+		bench("string", "str_replace()", n, [&]() { return str_replace("Fox", "Cat", input).size(); });
+		bench("string", "str_replace() arrays", n, [&]() { return str_replace(search, replace, input).size(); });
+		bench("string", "strtr() arrays", n, [&]() { return strtr(input, search, replace).size(); });
+		bench("string", "strtr() compiled", n, [&]() { return strtr(input, table).size(); });
+	}
+
+	// these take short values no matter how they are used, so there is only the one size
+	std::string out;
+	bench("string", "str_format()", 0, [&]() { return str_format("%s=%d (%.2f%%)", "requests", 48213, 99.25).size(); });
+	bench("string", "str_format_append() reused", 0, [&]() { out.clear(); str_format_append(out, "%s=%d (%.2f%%)", "requests", 48213, 99.25); return out.size(); });
+	bench("string", "number_format()", 0, [&]() { return number_format(1234567.891, 2).size(); });
+	bench("string", "number_format_append() reused", 0, [&]() { out.clear(); number_format_append(out, 1234567.891, 2); return out.size(); });
+}
+
+void bench_math()
+{
+	bench("math", "rand()", 0, [&]() { return (size_t)ramnet::rand(); });
+	bench("math", "random_int()", 0, [&]() { return (size_t)random_int(1, 100); });
+	bench("math", "random_int() x1000", 0, [&]() { return random_int(1, 100, 1000).size(); });
+	for(size_t n : { 16, 4096, 1 << 20 })
+	{
+		bench("math", "random_bytes()", n, [&]() { return random_bytes(n).size(); });
+	}
+
+	std::string integer = "-9223372036854775807";
+	std::string number = "  6.02214076e23";
+	long long i;
+	double d;
+	bench("math", "is_int()", integer.size(), [&]() { return (size_t)is_int(integer, i); });
+	bench("math", "intval()", integer.size(), [&]() { return (size_t)intval(integer); });
+	bench("math", "is_numeric()", number.size(), [&]() { return (size_t)is_numeric(number, d); });
+	bench("math", "floatval()", number.size(), [&]() { return (size_t)floatval(number); });
+}
+
+void bench_array()
+{
+	for(const std::string &input : inputs())
+	{
+		size_t n = input.size();
+		std::vector<std::string> words = explode(" ", input);
+		bench("array", "explode()", n, [&]() { return explode(" ", input).size(); });
+		bench("array", "explode() limit 2", n, [&]() { return explode(" ", input, 2).size(); });
+		bench("array", "explode_next()", n, [&]()
+		{
+			size_t pos = 0, seg_pos = 0, seg_len = 0, count = 0;
+			while(explode_next(" ", input, pos, seg_pos, seg_len))
+			{
+				count++;
+			}
+			return count;
+		});
+		bench("array", "str_split()", n, [&]() { return str_split(input, 4).size(); });
+		bench("array", "implode()", n, [&]() { return implode(" ", words).size(); });
+		bench("array", "shuffle()", 0, [&]() { shuffle(words); return words.size(); });
+		bench("array", "array_rand() 3", 0, [&]() { return array_rand(words, 3).size(); });
+
+		// as many numeric ids as there are words
+		std::vector<unsigned int> ids(words.size());
+		for(size_t i = 0; i < ids.size(); i++)
+		{
+			ids[i] = 1000000 + i * 7;
+		}
+		bench("array", "implode() ints", 0, [&]() { return implode(",", ids).size(); });
+	}
+}
+
+void bench_base64()
+{
+	// 1 KB up to 100 MB of random bytes, the legacy numbers are the vendored base64.cpp the library used to call
+	for(size_t n : { 1 << 10, 1 << 16, 1 << 20, 100 << 20 })
+	{
+		std::string input = random_bytes(n);
+		std::string encoded = ramnet::base64_encode(input);
+		bench("base64", "legacy base64_encode()", n, [&]() { return ::base64_encode(input, false).size(); });
+		bench("base64", "base64_encode()", n, [&]() { return ramnet::base64_encode(input).size(); });
+		bench("base64", "base64_encode_url()", n, [&]() { return base64_encode_url(input).size(); });
+		bench("base64", "legacy base64_decode()", encoded.size(), [&]() { return ::base64_decode(encoded, false).size(); });
+		bench("base64", "base64_decode()", encoded.size(), [&]() { return ramnet::base64_decode(encoded).size(); });
+		std::string pem = ramnet::base64_encode_pem(input);
+		// base64.cpp inserts the line breaks one at a time, which is quadratic, so it only runs on the small sizes
+		if(n <= 1 << 16)
+		{
+			bench("base64", "legacy base64_encode_pem()", n, [&]() { return ::base64_encode_pem(input).size(); });
+		}
+		bench("base64", "base64_encode_pem()", n, [&]() { return ramnet::base64_encode_pem(input).size(); });
+		bench("base64", "base64_encode_mime()", n, [&]() { return base64_encode_mime(input).size(); });
+		bench("base64", "legacy base64_decode() linebreaks", pem.size(), [&]() { return ::base64_decode(pem, true).size(); });
+		bench("base64", "base64_decode_mime()", pem.size(), [&]() { return base64_decode_mime(pem).size(); });
+
+		std::string decoded;
+		size_t offset;
+		bench("base64", "base64_decode_into() reused", encoded.size(), [&]() { base64_decode_into(encoded, decoded, offset); return decoded.size(); });
+
+		// the output buffer is reused between chunks, as a caller piping a file would
+		std::string out;
+		bench("base64", "base64_encode_update() 64 KB chunks", n, [&]()
+		{
+			base64_stream stream = base64_stream_init();
+			size_t total = 0;
+			for(size_t i = 0; i < n; i += 65536)
+			{
+				out.clear();
+				base64_encode_update(stream, input.data() + i, std::min(n - i, (size_t)65536), out);
+				total = total + out.size();
+			}
+			out.clear();
+			base64_encode_final(stream, out);
+			return total + out.size();
+		});
+		bench("base64", "base64_decode_update() 64 KB chunks", encoded.size(), [&]()
+		{
+			base64_stream stream = base64_stream_init();
+			size_t total = 0;
+			for(size_t i = 0; i < encoded.size(); i += 65536)
+			{
+				out.clear();
+				base64_decode_update(stream, encoded.data() + i, std::min(encoded.size() - i, (size_t)65536), out);
+				total = total + out.size();
+			}
+			out.clear();
+			base64_decode_final(stream, out);
+			return total + out.size();
+		});
+	}
+}
+
+// untrusted input that turns out not to be base64, where base64.cpp pays for throwing
+void bench_base64_invalid()
+{
+	std::string bad = "SGVsbG8sIFdvcmxkIQ*=";
+	std::string decoded;
+	size_t offset;
+	bench("base64", "legacy base64_decode() bad input", bad.size(), [&]()
+	{
+		try
+		{
+			return ::base64_decode(bad, false).size();
+		}
+		catch(const std::exception &e)
+		{
+			return (size_t)0;
+		}
+	});
+	bench("base64", "base64_decode_into() bad input", bad.size(), [&]() { return (size_t)base64_decode_into(bad, decoded, offset); });
+}
+
+void bench_url()
+{
+	// text is mostly left alone, random bytes are mostly escaped
+	for(size_t n : { 1 << 10, 1 << 16, 1 << 20 })
+	{
+		std::string text = str_repeat("q=the quick brown fox&page=2&sort=date-desc&", n / 44 + 1).substr(0, n);
+		std::string binary = random_bytes(n);
+		std::string encoded = urlencode(text);
+		std::string hex = bin2hex(binary);
+		bench("url", "legacy urlencode() text", n, [&]() { return legacy::urlencode(text).size(); });
+		bench("url", "urlencode() text", n, [&]() { return urlencode(text).size(); });
+		bench("url", "urlencode() binary", n, [&]() { return urlencode(binary).size(); });
+		bench("url", "rawurlencode() text", n, [&]() { return rawurlencode(text).size(); });
+		bench("url", "urldecode() text", encoded.size(), [&]() { return urldecode(encoded).size(); });
+		bench("url", "rawurldecode() text", encoded.size(), [&]() { return rawurldecode(encoded).size(); });
+		bench("url", "bin2hex()", n, [&]() { return bin2hex(binary).size(); });
+		bench("url", "hex2bin()", hex.size(), [&]() { return hex2bin(hex).size(); });
+	}
+}
+
+void bench_filesystem()
+{
+	for(const std::string &input : inputs())
+	{
+		bench("file", "file_put_contents()", input.size(), [&]() { return file_put_contents("bench.tmp", input); });
+		bench("file", "file_put_contents() append", input.size(), [&]() { return file_put_contents("bench.tmp", input, FILE_APPEND); });
+		file_put_contents("bench.tmp", input);
+		bench("file", "file_get_contents()", input.size(), [&]() { return file_get_contents("bench.tmp").size(); });
+	}
+	bench("file", "file_exists()", 0, [&]() { return (size_t)file_exists("bench.tmp"); });
+	bench("file", "is_readable()", 0, [&]() { return (size_t)is_readable("bench.tmp"); });
+	bench("file", "is_writable()", 0, [&]() { return (size_t)is_writable("bench.tmp"); });
+	ramnet::unlink("bench.tmp");
+	bench("file", "unlink() missing file", 0, [&]() { return (size_t)ramnet::unlink("bench.tmp"); });
+}
+
+void bench_process()
+{
+	// shell_exec() writes all of the input before it reads anything back, a megabyte through cat would
+	// fill both pipes and never finish, so the large input is left out here
+	std::vector<std::string> sizes = inputs();
+	sizes.pop_back();
+	for(const std::string &input : sizes)
+	{
+		bench("process", "shell_exec() cat", input.size(), [&]() { return shell_exec("cat", input).size(); });
+	}
+}
+
+// a listening socket on a free port of 127.0.0.1 for the forked servers below, port is filled in
+int loopback_listener(int &port)
+{
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	socklen_t len = sizeof(addr);
+	if(listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listener, 128) < 0
+	|| getsockname(listener, (struct sockaddr *)&addr, &len) < 0)
+	{
+		std::cerr << "could not start the loopback server" << std::endl;
+		exit(1);
+	}
+	port = ntohs(addr.sin_port);
+	return listener;
+}
+
+// a forked stand-in for a real server on 127.0.0.1. it answers an http GET with a small page and
+// echoes everything else back, one connection at a time. returns the pid, port is filled in.
+pid_t loopback_server(int &port)
+{
+	int listener = loopback_listener(port);
+	pid_t pid = fork();
+	if(pid != 0)
+	{
+		::close(listener);
+		return pid;
+	}
+
+	const std::string page = "HTTP/1.0 200 OK\r\nContent-Length: 13\r\nContent-Type: text/plain\r\n\r\nHello, World!";
+	char buf[65536];
+	while(true)
+	{
+		int sock = accept(listener, NULL, NULL);
+		if(sock < 0)
+		{
+			continue;
+		}
+		ssize_t n;
+		bool first = true;
+		while((n = read(sock, buf, sizeof(buf))) > 0)
+		{
+			if(first && n >= 4 && memcmp(buf, "GET ", 4) == 0)
+			{
+				if(write(sock, page.data(), page.size()) < 0) {}
+				break;
+			}
+			first = false;
+			if(write(sock, buf, n) != n)
+			{
+				break;
+			}
+		}
+		::close(sock);
+	}
+}
+
+// a throwaway self-signed certificate and key for localhost in a new directory, made with the openssl tool.
+// returns the directory, cert.pem and key.pem are in it, or "" when openssl is missing
+std::string tls_keypair()
+{
+	std::string dir = trim(shell_exec("mktemp -d"));
+	int status;
+	shell_exec("openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj /CN=localhost -addext subjectAltName=DNS:localhost"
+		" -keyout " + dir + "/key.pem -out " + dir + "/cert.pem 2>&1", "", status, 60);
+	if(dir == "" || status != 0)
+	{
+		shell_exec("rm -rf " + dir);
+		return "";
+	}
+	return dir;
+}
+
+// a forked libtls server on 127.0.0.1 with the keypair in dir. it finishes the handshake of each
+// connection and closes it again. tls 1.2 only, the version libtls resumes from a session file.
+// returns the pid, port is filled in.
+pid_t loopback_tls_server(int &port, const std::string &dir)
+{
+	int listener = loopback_listener(port);
+	pid_t pid = fork();
+	if(pid != 0)
+	{
+		::close(listener);
+		return pid;
+	}
+
+	struct tls_config *config = tls_config_new();
+	struct tls *server = tls_server();
+	if(config == NULL || server == NULL
+	|| tls_config_set_keypair_file(config, (dir + "/cert.pem").c_str(), (dir + "/key.pem").c_str()) != 0
+	|| tls_config_set_protocols(config, TLS_PROTOCOL_TLSv1_2) != 0
+	|| tls_config_set_session_lifetime(config, 300) != 0 || tls_configure(server, config) != 0)
+	{
+		std::cerr << "could not start the loopback tls server" << std::endl;
+		_exit(1);
+	}
+	while(true)
+	{
+		int sock = accept(listener, NULL, NULL);
+		if(sock < 0)
+		{
+			continue;
+		}
+		struct tls *conn = NULL;
+		if(tls_accept_socket(server, &conn, sock) == 0)
+		{
+			int ret;
+			while((ret = tls_handshake(conn)) == TLS_WANT_POLLIN || ret == TLS_WANT_POLLOUT)
+			{
+			}
+			if(ret == 0)
+			{
+				tls_close(conn);
+			}
+		}
+		tls_free(conn);
+		::close(sock);
+	}
+}
+
+// connections per second for the last benchmark, when the filter let it run
+void print_connections(size_t ran)
+{
+	if(results.size() > ran)
+	{
+		std::cout << str_format("%-11s%-36s%12.0f connections/s", results.back().group, results.back().name, 1e9 / results.back().ns_per_op) << std::endl;
+	}
+}
+
+void bench_network()
+{
+	int port;
+	pid_t server = loopback_server(port);
+
+	bench("network", "gethostbyname() localhost", 0, [&]() { return ramnet::gethostbyname("localhost").size(); });
+	bench("network", "resolve_batch() 16 names", 0, [&]() { return resolve_batch(std::vector<std::string>(16, "localhost")).size(); });
+	resolver_set_ttl(0, 0);
+	bench("network", "gethostbyname() localhost uncached", 0, [&]() { return ramnet::gethostbyname("localhost").size(); });
+	resolver_set_ttl(60, 5);
+	bench("network", "sopen() + close()", 0, [&]()
+	{
+		int sock = sopen("127.0.0.1", port);
+		ramnet::close(sock);
+		return (size_t)sock;
+	});
+	int listener = slisten(0);
+	bench("network", "sopen() + saccept() + close()", 0, [&]()
+	{
+		int sock = sopen("127.0.0.1", socket_port(listener));
+		int accepted = saccept(listener);
+		ramnet::close(accepted);
+		ramnet::close(sock);
+		return (size_t)accepted;
+	});
+	ramnet::close(listener);
+	bench("network", "pool_sopen() + pool_release()", 0, [&]()
+	{
+		int sock = pool_sopen("127.0.0.1", port);
+		pool_release(sock);
+		return (size_t)sock;
+	});
+	pool_flush();
+	bench("network", "url_get_contents()", 0, [&]() { return url_get_contents("http://127.0.0.1:" + std::to_string(port) + "/").size(); });
+
+	// the megabyte input is left out, both sides would block writing it before reading the echo
+	int sock = sopen("127.0.0.1", port);
+	std::vector<std::string> lines = inputs();
+	lines.pop_back();
+	for(const std::string &line : lines)
+	{
+		bench("network", "write_line() + read_line()", line.size(), [&]()
+		{
+			write_line(sock, line);
+			return read_line(sock).size();
+		});
+	}
+
+	// many short lines per read(), the usual shape of a line protocol
+	std::string batch;
+	std::vector<std::string> batch_lines;
+	for(int i = 0; i < 100; i++)
+	{
+		batch_lines.push_back(std::string(98, 'a' + i % 26));
+		batch.append(batch_lines.back()).append("\r\n");
+	}
+	batch.resize(batch.size() - 2);
+	std::string line;
+	auto read_batch = [&]()
+	{
+		size_t total = 0;
+		for(int i = 0; i < 100; i++)
+		{
+			read_line(sock, line);
+			total += line.size();
+		}
+		return total;
+	};
+	bench("network", "write_line() + read_line() 100 lines", batch.size(), [&]()
+	{
+		write_line(sock, batch);
+		return read_batch();
+	});
+	bench("network", "write_lines() + read_line() 100 lines", batch.size(), [&]()
+	{
+		write_lines(sock, batch_lines);
+		return read_batch();
+	});
+	bench("network", "100 x write_line() + read_line()", batch.size(), [&]()
+	{
+		for(const std::string &batch_line : batch_lines)
+		{
+			write_line(sock, batch_line);
+		}
+		return read_batch();
+	});
+	ramnet::close(sock);
+
+	// one event loop answering a line on each of 1000 connections
+	const int connections = 1000;
+	int loop = evloop_create();
+	std::vector<int> clients;
+	size_t answered = 0;
+	for(int i = 0; i < connections; i++)
+	{
+		int pair[2];
+		if(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+		{
+			break;
+		}
+		clients.push_back(pair[1]);
+		evloop_add(loop, pair[0], [&](int sock, const std::string &request)
+		{
+			evloop_write_line(loop, sock, request);
+			answered++;
+		});
+	}
+	const std::string request(98, 'r');
+	bench("network", "evloop 1000 connections x 1 line", clients.size() * (request.size() + 2), [&]()
+	{
+		size_t expected = answered + clients.size();
+		for(int client : clients)
+		{
+			write_line(client, request);
+		}
+		while(answered < expected && evloop_run_once(loop, 1000) > 0)
+		{
+		}
+		size_t total = 0;
+		for(int client : clients)
+		{
+			read_line(client, line);
+			total += line.size();
+		}
+		return total;
+	});
+	evloop_destroy(loop);
+	for(int client : clients)
+	{
+		ramnet::close(client);
+	}
+
+	// tls connections to a libtls server with a throwaway certificate. ssl_sopen() resumes the session of the
+	// one before, the legacy version does a full handshake every time.
+	std::string dir = tls_keypair();
+	if(dir == "")
+	{
+		std::cerr << "openssl could not make a certificate, skipping the tls benchmarks" << std::endl;
+	}
+	else
+	{
+		int tls_port;
+		pid_t tls_server = loopback_tls_server(tls_port, dir);
+		const std::string ca_file = dir + "/cert.pem";
+		size_t ran = results.size();
+		bench("network", "ssl_sopen() + ssl_close()", 0, [&]()
+		{
+			int sock = ssl_sopen("localhost", tls_port, true, ca_file);
+			size_t resumed = ssl_session_resumed(sock);
+			ssl_close(sock);
+			return resumed;
+		});
+		print_connections(ran);
+		ran = results.size();
+		bench("network", "legacy ssl_sopen() + ssl_close()", 0, [&]() { return legacy::ssl_sopen_close("localhost", tls_port, ca_file); });
+		print_connections(ran);
+		kill(tls_server, SIGTERM);
+		waitpid(tls_server, NULL, 0);
+		shell_exec("rm -rf " + dir);
+	}
+
+	kill(server, SIGTERM);
+	waitpid(server, NULL, 0);
+}
+
+// hand written so the output does not depend on a json library
+void write_json(const std::string &file)
+{
+	std::string json = "{\n\t\"benchmarks\": [\n";
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		const bench_result &r = results[i];
+		str_format_append(json, "\t\t{ \"group\": \"%s\", \"name\": \"%s\", \"bytes\": %u, \"iterations\": %u, \"ns_per_op\": %.2f, \"bytes_per_sec\": %.0f, \"allocs_per_op\": %.3f }%s\n",
+			r.group, r.name, r.bytes, r.iterations, r.ns_per_op, r.bytes == 0 ? 0.0 : r.bytes * 1e9 / r.ns_per_op, r.allocs_per_op, i + 1 < results.size() ? "," : "");
+	}
+	json.append("\t]\n}\n");
+	if(file_put_contents(file, json) != json.size())
+	{
+		std::cerr << "could not write " << file << std::endl;
+		exit(1);
+	}
+	std::cout << "wrote " << results.size() << " results to " << file << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	std::string output = "bench_output.json";
+	if(argc > 1)
+	{
+		output = argv[1];
+	}
+	if(argc > 2)
+	{
+		filter = argv[2];
+	}
+
+	bench_string();
+	bench_math();
+	bench_array();
+	bench_base64();
+	bench_base64_invalid();
+	bench_url();
+	bench_filesystem();
+	bench_process();
+	bench_network();
+
+	write_json(output);
+	return 0;
+}
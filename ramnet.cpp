@@ -30,10 +30,21 @@
 #include <climits>
 #include <vector>
 #include <map>
+#include <memory>
 #include <sstream>
 #include <utility>
+#include <tuple>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <system_error>
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
 
 #include <netdb.h>
 #include <arpa/inet.h>
@@ -41,6 +52,20 @@
 #include <signal.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <netinet/tcp.h>
+
+// sse2 is the x86-64 baseline. ssse3 and avx2 kernels are compiled with a target attribute and only picked at runtime.
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define _RAMNET_SSSE3_ __attribute__((target("ssse3")))
+#define _RAMNET_AVX2_ __attribute__((target("avx2")))
+#endif
 
 // this can be found in "apk add curl-dev"
 #include <curl/curl.h>
@@ -122,745 +147,5660 @@ http http_fetch(const std::string url)
 
 } // end anonymous namespace
 
-/****************
- * base64 stuff *
- ****************
+/***********************
+ * internal simd stuff *
+ ***********************
 */
 
-std::string __base64_encode(const std::string &str)
+namespace {
+
+// byte kernels work on a buffer in place, so they serve both the copying and the *_inplace functions.
+typedef void (*byte_kernel)(char *, size_t);
+
+// these only ever touch ASCII letters. unlike std::toupper() they don't depend on the locale, the same as PHP 8.
+void _ascii_upper_scalar(char *p, size_t n)
 {
-	return base64_encode(str);
+	for(size_t i = 0; i < n; i++)
+	{
+		if(p[i] >= 'a' && p[i] <= 'z') { p[i] = p[i] ^ 0x20; }
+	}
 }
 
-std::string __base64_decode(const std::string &str)
+void _ascii_lower_scalar(char *p, size_t n)
 {
-	return base64_decode(str);
+	for(size_t i = 0; i < n; i++)
+	{
+		if(p[i] >= 'A' && p[i] <= 'Z') { p[i] = p[i] ^ 0x20; }
+	}
 }
 
-/*********************
- * process functions *
-**********************
-*/
-
-struct popen2
+void _ascii_rot13_scalar(char *p, size_t n)
 {
-	pid_t child_pid;
-	int from_child, to_child;
-};
+	for(size_t i = 0; i < n; i++)
+	{
+		char lower = p[i] | 0x20;
+		if(lower >= 'a' && lower <= 'm') { p[i] = p[i] + 13; }
+		else if(lower >= 'n' && lower <= 'z') { p[i] = p[i] - 13; }
+	}
+}
 
-struct shell_exec
-{
-	int status;
-	std::string output;
-};
+#if defined(__SSE2__)
 
-int popen2(const char *cmdline, struct popen2 *childinfo)
+// 0xff in every byte of v that lies in [lo, lo + count).
+// shifting lo down to -128 turns the range check into a single signed compare.
+inline __m128i _sse2_in_range(__m128i v, char lo, char count)
 {
-	pid_t p;
-	int pipe_stdin[2], pipe_stdout[2];
-
-	if(pipe(pipe_stdin)) return -1;
-	if(pipe(pipe_stdout)) return -1;
+	__m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(-128 - lo)));
+	return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + count)));
+}
 
-	p = fork();
-	if(p < 0) return p; /* fork failed */
-	if(p == 0)
+// flips the case bit of every byte in [lo, lo + 26)
+inline void _sse2_flip_case(char *p, size_t n, char lo)
+{
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16)
 	{
-		/* child */
-		close(pipe_stdin[1]);
-		dup2(pipe_stdin[0], 0);
-		close(pipe_stdout[0]);
-		dup2(pipe_stdout[1], 1);
-		execl("/bin/sh", "sh", "-c", cmdline, NULL);
-		perror("execl");
-		exit(EXIT_FAILURE);
+		__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+		__m128i flip = _mm_and_si128(_sse2_in_range(v, lo, 26), _mm_set1_epi8(0x20));
+		_mm_storeu_si128((__m128i *)(p + i), _mm_xor_si128(v, flip));
 	}
-	childinfo->child_pid = p;
-	childinfo->to_child = pipe_stdin[1];
-	childinfo->from_child = pipe_stdout[0];
-	return 0;
+	if(lo == 'a') { _ascii_upper_scalar(p + i, n - i); }
+	else { _ascii_lower_scalar(p + i, n - i); }
 }
 
-// simple wrapper around popen2()
-// ensures process terminatation after timeout seconds. timeout 0 runs forever.
-std::string shell_exec(const std::string &cmd, const std::string &input, int &status, int timeout)
-{
-	char buf[8192];
-	struct popen2 kid;
-	popen2(cmd.c_str(), &kid);
-	write(kid.to_child, input.c_str(), input.length());
-	close(kid.to_child);
-	memset(buf, 0, 8192);
+void _ascii_upper_sse2(char *p, size_t n) { _sse2_flip_case(p, n, 'a'); }
+void _ascii_lower_sse2(char *p, size_t n) { _sse2_flip_case(p, n, 'A'); }
 
-	if(timeout > 0)
+void _ascii_rot13_sse2(char *p, size_t n)
+{
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16)
 	{
-		timeout = timeout * 10;
-		for(int i = 0; i < timeout; i++)
-		{
-			if(waitpid(kid.child_pid, &status, WNOHANG) != 0)
-			{
-				// process finished before timeout.
-				break;
-			}
-			usleep(100000); // 0.1 second
-		}
-		if(waitpid(kid.child_pid, &status, WNOHANG) == 0)
-		{
-			// process still running. kill it.
-			kill(kid.child_pid, SIGTERM);
-			usleep(100000);
-			if(waitpid(kid.child_pid, &status, WNOHANG) == 0)
-			{
-				kill(kid.child_pid, SIGKILL);
-			}
-		}
+		__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+		__m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		__m128i alpha = _sse2_in_range(lower, 'a', 26);
+		__m128i first = _sse2_in_range(lower, 'a', 13);
+		// +13 for a-m, -13 for n-z, 0 for everything else
+		__m128i delta = _mm_or_si128(_mm_and_si128(first, _mm_set1_epi8(13)), _mm_andnot_si128(first, _mm_and_si128(alpha, _mm_set1_epi8(-13))));
+		_mm_storeu_si128((__m128i *)(p + i), _mm_add_epi8(v, delta));
 	}
+	_ascii_rot13_scalar(p + i, n - i);
+}
 
-	// wait for and reap the child
-	waitpid(kid.child_pid, &status, 0);
-
-	// collect all of the output from child, do not block
-	fcntl(kid.from_child, F_SETFL, O_NONBLOCK);
-	read(kid.from_child, buf, 8192);
-	close(kid.from_child);
-
-	std::string output = buf;
-	status = WEXITSTATUS(status);
+#endif
 
-	return output;
-}
+#if defined(_RAMNET_AVX2_)
 
-// alternative way of calling shell_exec() with fewer arguments
-std::string shell_exec(const std::string &cmd, const std::string &input, int &status)
+_RAMNET_AVX2_ inline __m256i _avx2_in_range(__m256i v, char lo, char count)
 {
-	return shell_exec(cmd, input, status, 0);
+	__m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8((char)(-128 - lo)));
+	return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + count)), shifted);
 }
 
-// alternative way of calling shell_exec() with fewer arguments
-std::string shell_exec(const std::string &cmd, const std::string &input)
+_RAMNET_AVX2_ inline void _avx2_flip_case(char *p, size_t n, char lo)
 {
-	int status;
-	return shell_exec(cmd, input, status);
+	size_t i = 0;
+	for(; i + 32 <= n; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+		__m256i flip = _mm256_and_si256(_avx2_in_range(v, lo, 26), _mm256_set1_epi8(0x20));
+		_mm256_storeu_si256((__m256i *)(p + i), _mm256_xor_si256(v, flip));
+	}
+	if(lo == 'a') { _ascii_upper_scalar(p + i, n - i); }
+	else { _ascii_lower_scalar(p + i, n - i); }
 }
 
-// alternative way of calling shell_exec() with fewer arguments
-std::string shell_exec(const std::string &cmd)
+_RAMNET_AVX2_ void _ascii_upper_avx2(char *p, size_t n) { _avx2_flip_case(p, n, 'a'); }
+_RAMNET_AVX2_ void _ascii_lower_avx2(char *p, size_t n) { _avx2_flip_case(p, n, 'A'); }
+
+_RAMNET_AVX2_ void _ascii_rot13_avx2(char *p, size_t n)
 {
-	return shell_exec(cmd, "");
+	size_t i = 0;
+	for(; i + 32 <= n; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+		__m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+		__m256i alpha = _avx2_in_range(lower, 'a', 26);
+		__m256i first = _avx2_in_range(lower, 'a', 13);
+		__m256i delta = _mm256_or_si256(_mm256_and_si256(first, _mm256_set1_epi8(13)), _mm256_andnot_si256(first, _mm256_and_si256(alpha, _mm256_set1_epi8(-13))));
+		_mm256_storeu_si256((__m256i *)(p + i), _mm256_add_epi8(v, delta));
+	}
+	_ascii_rot13_scalar(p + i, n - i);
 }
 
-/******************
- * math functions *
- ******************
-*/
+#endif
 
-int rand(const int min /* = 0 */, const int max /* = RAND_MAX */)
+// finds needle in haystack, returns its offset or npos. needs nn >= 1.
+// memchr finds candidates for the first byte, memcmp checks the rest.
+size_t _search_short_scalar(const char *h, size_t hn, const char *n, size_t nn)
 {
-	/* this is ugly but this is the correct way in C++ to get a random number from a specific range using the standard library only */
-	return min + std::rand() / (RAND_MAX / (max - min + 1) + 1);
+	if(nn > hn)
+	{
+		return std::string::npos;
+	}
+	const char *p = h;
+	const char *end = h + hn - nn + 1;
+	while(p < end)
+	{
+		p = (const char *)memchr(p, n[0], end - p);
+		if(p == NULL)
+		{
+			break;
+		}
+		if(memcmp(p + 1, n + 1, nn - 1) == 0)
+		{
+			return p - h;
+		}
+		p++;
+	}
+	return std::string::npos;
 }
 
-/********************
- * string functions *
- ********************
-*/
+#if defined(__SSE2__)
 
-bool is_int(const std::string &str)
+// the simd search kernels compare the first and the last byte of needle against 16 (or 32) haystack positions at once,
+// and only run memcmp where both match. needs nn >= 2.
+size_t _search_short_sse2(const char *h, size_t hn, const char *n, size_t nn)
 {
-	if(str.find_first_not_of("0123456789") == std::string::npos)
+	const __m128i first = _mm_set1_epi8(n[0]);
+	const __m128i last = _mm_set1_epi8(n[nn - 1]);
+	size_t i = 0;
+	for(; i + nn - 1 + 16 <= hn; i += 16)
 	{
-		return true;
+		__m128i block_first = _mm_loadu_si128((const __m128i *)(h + i));
+		__m128i block_last = _mm_loadu_si128((const __m128i *)(h + i + nn - 1));
+		unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+		while(mask != 0)
+		{
+			unsigned int bit = __builtin_ctz(mask);
+			if(memcmp(h + i + bit + 1, n + 1, nn - 2) == 0)
+			{
+				return i + bit;
+			}
+			mask = mask & (mask - 1);
+		}
 	}
-	return false;
+	size_t found = _search_short_scalar(h + i, hn - i, n, nn);
+	return found == std::string::npos ? found : i + found;
 }
 
-std::string ltrim(const std::string &str, const std::string &whitespace /* = " \n\r\t\f\v" */)
+#endif
+
+#if defined(_RAMNET_AVX2_)
+
+_RAMNET_AVX2_ size_t _search_short_avx2(const char *h, size_t hn, const char *n, size_t nn)
 {
-	size_t start = str.find_first_not_of(whitespace);
-	if(start == std::string::npos)
+	const __m256i first = _mm256_set1_epi8(n[0]);
+	const __m256i last = _mm256_set1_epi8(n[nn - 1]);
+	size_t i = 0;
+	for(; i + nn - 1 + 32 <= hn; i += 32)
 	{
-		return "";
+		__m256i block_first = _mm256_loadu_si256((const __m256i *)(h + i));
+		__m256i block_last = _mm256_loadu_si256((const __m256i *)(h + i + nn - 1));
+		unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last)));
+		while(mask != 0)
+		{
+			unsigned int bit = __builtin_ctz(mask);
+			if(memcmp(h + i + bit + 1, n + 1, nn - 2) == 0)
+			{
+				return i + bit;
+			}
+			mask = mask & (mask - 1);
+		}
 	}
-	return str.substr(start);
+	size_t found = _search_short_scalar(h + i, hn - i, n, nn);
+	return found == std::string::npos ? found : i + found;
 }
 
-std::string rtrim(const std::string &str, const std::string &whitespace /* = " \n\r\t\f\v" */)
+#endif
+
+// length of the run of ascii digits at the start of p
+size_t _digit_run(const char *p, size_t n)
 {
-	size_t end = str.find_last_not_of(whitespace);
-	if(end == std::string::npos)
+	size_t i = 0;
+#if defined(__SSE2__)
+	for(; i + 16 <= n; i += 16)
 	{
-		return "";
+		__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+		unsigned int not_digits = ~_mm_movemask_epi8(_sse2_in_range(v, '0', 10)) & 0xffff;
+		if(not_digits != 0)
+		{
+			return i + __builtin_ctz(not_digits);
+		}
 	}
-	return str.substr(0, end + 1);
+#endif
+	while(i < n && p[i] >= '0' && p[i] <= '9')
+	{
+		i++;
+	}
+	return i;
 }
 
-std::string trim(const std::string &str, const std::string &whitespace /* = " \n\r\t\f\v" */)
+// true for the characters urlencode() copies unchanged: ascii letters, digits and "-_.", and '~' as well
+// for rawurlencode() (raw = true)
+inline bool _url_plain(unsigned char c, bool raw)
 {
-	return rtrim(ltrim(str, whitespace), whitespace);
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.' || (raw && c == '~');
 }
 
-// C++24 supposedly will have it's own std::string.contains(). In the meantime, this provides str_contains() from PHP 8
-bool str_contains(const std::string &haystack, const std::string &needle)
+// urlencode() kernels encode in into out and return the length of the result.
+// with out NULL they only work out the length, so the result can be sized exactly before it is written.
+// the simd ones store up to 32 bytes past the end of the result, out needs that much slack.
+typedef size_t (*urlencode_kernel)(const char *, size_t, char *, bool);
+
+// writes the %XX (or '+') for one byte that urlencode() doesn't copy as it is, returns how many characters that took
+inline size_t _url_escape(char *out, unsigned char c, bool raw)
 {
-	if(haystack.find(needle) != std::string::npos)
+	if(raw == false && c == ' ')
 	{
-		return true;
+		out[0] = '+';
+		return 1;
 	}
-	return false;
-}
-
-std::string strrev(std::string str)
-{
-	reverse(str.begin(), str.end());
-	return str;
+	out[0] = '%';
+	out[1] = "0123456789ABCDEF"[c >> 4];
+	out[2] = "0123456789ABCDEF"[c & 0x0f];
+	return 3;
 }
 
-std::string str_rot13(const std::string &str)
+size_t _urlencode_scalar(const char *in, size_t n, char *out, bool raw)
 {
-	std::string result;
-	for(size_t i = 0; i < str.size(); i++)
+	size_t length = 0;
+	for(size_t i = 0; i < n; i++)
 	{
-		if(isalpha(str[i]))
+		unsigned char c = in[i];
+		if(_url_plain(c, raw))
 		{
-			if((tolower(str[i]) - 'a') < 14)
-			{
-				result.append(1, str[i] + 13);
-			}
-			else
-			{
-				result.append(1, str[i] - 13);
-			}
+			if(out != NULL) { out[length] = c; }
+			length++;
+		}
+		else if(out != NULL)
+		{
+			length = length + _url_escape(out + length, c, raw);
 		}
 		else
 		{
-			result.append(1, str[i]);
+			length = length + (raw == false && c == ' ' ? 1 : 3);
 		}
 	}
-	return result;
+	return length;
 }
 
-std::string str_repeat(const std::string &str, const size_t times)
-{
-	size_t loop;
-	std::string result;
+#if defined(__SSE2__)
 
-	loop = 0;
-	while(loop < times)
+// blocks with nothing to escape are copied whole, the others go through the scalar loop
+size_t _urlencode_sse2(const char *in, size_t n, char *out, bool raw)
+{
+	__m128i tilde = _mm_set1_epi8(raw ? '~' : '-');
+	__m128i space = _mm_set1_epi8(raw ? '-' : ' ');
+	size_t length = 0;
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16)
 	{
-		result.append(str);
-		loop++;
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		// folding the case bit in lets one range check cover both cases of letter
+		__m128i plain = _mm_or_si128(_sse2_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 26), _sse2_in_range(v, '0', 10));
+		plain = _mm_or_si128(plain, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('-')), _mm_cmpeq_epi8(v, _mm_set1_epi8('_'))));
+		plain = _mm_or_si128(plain, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('.')), _mm_cmpeq_epi8(v, tilde)));
+		unsigned int special = ~_mm_movemask_epi8(plain) & 0xffff;
+		if(special == 0)
+		{
+			if(out != NULL) { _mm_storeu_si128((__m128i *)(out + length), v); }
+			length = length + 16;
+		}
+		else if(out == NULL)
+		{
+			// every special byte takes 3, except a space which takes 1
+			unsigned int spaces = _mm_movemask_epi8(_mm_cmpeq_epi8(v, space));
+			length = length + 16 + 2 * (__builtin_popcount(special) - __builtin_popcount(special & spaces));
+		}
+		else
+		{
+			// the plain stretches between special bytes are copied a whole register at a time,
+			// from a copy of the block so the loads never run past the end of in
+			char block[32];
+			_mm_storeu_si128((__m128i *)block, v);
+			_mm_storeu_si128((__m128i *)(block + 16), _mm_setzero_si128());
+			unsigned int pos = 0;
+			while(special != 0)
+			{
+				unsigned int k = __builtin_ctz(special);
+				_mm_storeu_si128((__m128i *)(out + length), _mm_loadu_si128((const __m128i *)(block + pos)));
+				length = length + k - pos;
+				length = length + _url_escape(out + length, block[k], raw);
+				pos = k + 1;
+				special = special & (special - 1);
+			}
+			_mm_storeu_si128((__m128i *)(out + length), _mm_loadu_si128((const __m128i *)(block + pos)));
+			length = length + 16 - pos;
+		}
 	}
-	return result;
+	return length + _urlencode_scalar(in + i, n - i, out == NULL ? NULL : out + length, raw);
 }
 
-std::string str_pad(const std::string &input, size_t length, const std::string pad_str /* = " " */, size_t pad_type /* = STR_PAD_RIGHT */)
-{
-	std::string result;
+#endif
 
-	// no length available to do any padding. return input untouched.
-	if(input.size() >= length) { return input; }
+#if defined(_RAMNET_AVX2_)
 
-	if(pad_type == STR_PAD_RIGHT || pad_type == STR_PAD_LEFT || pad_type == STR_PAD_BOTH)
+_RAMNET_AVX2_ size_t _urlencode_avx2(const char *in, size_t n, char *out, bool raw)
+{
+	__m256i tilde = _mm256_set1_epi8(raw ? '~' : '-');
+	__m256i space = _mm256_set1_epi8(raw ? '-' : ' ');
+	size_t length = 0;
+	size_t i = 0;
+	for(; i + 32 <= n; i += 32)
 	{
-		for(size_t i = input.size(); i < length; i = i + pad_str.size())
+		__m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+		__m256i plain = _mm256_or_si256(_avx2_in_range(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 26), _avx2_in_range(v, '0', 10));
+		plain = _mm256_or_si256(plain, _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'))));
+		plain = _mm256_or_si256(plain, _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('.')), _mm256_cmpeq_epi8(v, tilde)));
+		unsigned int special = ~(unsigned int)_mm256_movemask_epi8(plain);
+		if(special == 0)
 		{
-			if(input.size() + result.size() + pad_str.size() < length)
-			{
-				result.append(pad_str);
-			}
-			else
+			if(out != NULL) { _mm256_storeu_si256((__m256i *)(out + length), v); }
+			length = length + 32;
+		}
+		else if(out == NULL)
+		{
+			unsigned int spaces = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, space));
+			length = length + 32 + 2 * (__builtin_popcount(special) - __builtin_popcount(special & spaces));
+		}
+		else
+		{
+			char block[64];
+			_mm256_storeu_si256((__m256i *)block, v);
+			_mm256_storeu_si256((__m256i *)(block + 32), _mm256_setzero_si256());
+			unsigned int pos = 0;
+			while(special != 0)
 			{
-				result.append(pad_str.substr(0, length - i));
+				unsigned int k = __builtin_ctz(special);
+				_mm256_storeu_si256((__m256i *)(out + length), _mm256_loadu_si256((const __m256i *)(block + pos)));
+				length = length + k - pos;
+				length = length + _url_escape(out + length, block[k], raw);
+				pos = k + 1;
+				special = special & (special - 1);
 			}
+			_mm256_storeu_si256((__m256i *)(out + length), _mm256_loadu_si256((const __m256i *)(block + pos)));
+			length = length + 32 - pos;
 		}
 	}
+	return length + _urlencode_scalar(in + i, n - i, out == NULL ? NULL : out + length, raw);
+}
 
-	if(pad_type == STR_PAD_RIGHT)
-	{
-		result.insert(0, input);
-	}
-	if(pad_type == STR_PAD_LEFT)
+#endif
+
+// length of the run at the start of p that urldecode() copies unchanged, up to the next '%', or '+' unless raw
+size_t _url_encoded_run(const char *p, size_t n, bool raw)
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	__m128i plus = _mm_set1_epi8(raw ? '%' : '+');
+	for(; i + 16 <= n; i += 16)
 	{
-		result.append(input);
+		__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+		unsigned int special = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('%')), _mm_cmpeq_epi8(v, plus)));
+		if(special != 0)
+		{
+			return i + __builtin_ctz(special);
+		}
 	}
-	if(pad_type == STR_PAD_BOTH)
+#endif
+	while(i < n && p[i] != '%' && (raw || p[i] != '+'))
 	{
-		size_t half = (length - input.size()) / 2;
-		std::string tmp = result;
-		result = "";
-
-		// this prefers padding right, just like PHP does
-		result.append(tmp.substr(0, half));
-		result.append(input);
-		result.append(tmp.substr(half, std::string::npos));
+		i++;
 	}
-	return result;
+	return i;
 }
 
-std::string ucfirst(const std::string &str)
+// writes n bytes as 2n lowercase hex digits
+void _hex_encode(const unsigned char *in, size_t n, char *out)
 {
-	std::string result = str;
-	result[0]=toupper(result[0]);
-	return result;
+	const char *digits = "0123456789abcdef";
+	size_t i = 0;
+#if defined(__SSE2__)
+	for(; i + 16 <= n; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		__m128i high = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+		__m128i low = _mm_and_si128(v, _mm_set1_epi8(0x0f));
+		// high nibble first, then turn each nibble into '0'-'9' or 'a'-'f'
+		__m128i first = _mm_unpacklo_epi8(high, low);
+		__m128i second = _mm_unpackhi_epi8(high, low);
+		first = _mm_add_epi8(_mm_add_epi8(first, _mm_set1_epi8('0')), _mm_and_si128(_mm_cmpgt_epi8(first, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10)));
+		second = _mm_add_epi8(_mm_add_epi8(second, _mm_set1_epi8('0')), _mm_and_si128(_mm_cmpgt_epi8(second, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10)));
+		_mm_storeu_si128((__m128i *)(out + i * 2), first);
+		_mm_storeu_si128((__m128i *)(out + i * 2 + 16), second);
+	}
+#endif
+	for(; i < n; i++)
+	{
+		out[i * 2] = digits[in[i] >> 4];
+		out[i * 2 + 1] = digits[in[i] & 0x0f];
+	}
 }
 
-std::string lcfirst(const std::string &str)
+// value of a hex digit, -1 if it isn't one
+inline int _hex_value(char c)
 {
-	std::string result = str;
-	result[0]=tolower(result[0]);
-	return result;
+	if(c >= '0' && c <= '9') { return c - '0'; }
+	c = c | 0x20;
+	if(c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+	return -1;
 }
 
-std::string strtoupper(const std::string &str)
-{
-	std::string result = str;
-	std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c){ return std::toupper(c); });
-	return result;
-}
+#if defined(__SSE2__)
 
-std::string strtolower(const std::string &str)
+// 16 hex digits to 8 bytes, one per 16 bit word. valid gets 0xff for every byte that was a hex digit.
+inline __m128i _sse2_hex_pairs(__m128i c, __m128i &valid)
 {
-	std::string result = str;
-	std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c){ return std::tolower(c); });
-	return result;
+	__m128i folded = _mm_or_si128(c, _mm_set1_epi8(0x20));
+	__m128i digit = _sse2_in_range(c, '0', 10);
+	__m128i letter = _sse2_in_range(folded, 'a', 6);
+	valid = _mm_or_si128(digit, letter);
+	__m128i value = _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))), _mm_and_si128(letter, _mm_sub_epi8(folded, _mm_set1_epi8('a' - 10))));
+	// the first digit of a pair is the low byte of its word and the high nibble of the result
+	return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(value, _mm_set1_epi16(0x00ff)), 4), _mm_srli_epi16(value, 8));
+}
+
+#endif
+
+// turns pairs of hex digits (either case) into bytes, n is even. returns how many digits it used,
+// which is less than n if it ran into something that isn't hex.
+size_t _hex_decode(const char *in, size_t n, unsigned char *out)
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	for(; i + 32 <= n; i += 32)
+	{
+		__m128i first_valid;
+		__m128i second_valid;
+		__m128i first = _sse2_hex_pairs(_mm_loadu_si128((const __m128i *)(in + i)), first_valid);
+		__m128i second = _sse2_hex_pairs(_mm_loadu_si128((const __m128i *)(in + i + 16)), second_valid);
+		if(_mm_movemask_epi8(_mm_and_si128(first_valid, second_valid)) != 0xffff)
+		{
+			break;
+		}
+		_mm_storeu_si128((__m128i *)(out + i / 2), _mm_packus_epi16(first, second));
+	}
+#endif
+	for(; i + 2 <= n; i += 2)
+	{
+		int high = _hex_value(in[i]);
+		int low = _hex_value(in[i + 1]);
+		if(high < 0 || low < 0)
+		{
+			break;
+		}
+		out[i / 2] = (high << 4) | low;
+	}
+	return i;
+}
+
+// true if the cpu we are running on can execute the avx2 kernels
+bool _cpu_has_avx2()
+{
+#if defined(_RAMNET_AVX2_)
+	static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+	return avx2;
+#else
+	return false;
+#endif
+}
+
+// true if the cpu we are running on can execute the ssse3 kernels (pshufb)
+bool _cpu_has_ssse3()
+{
+#if defined(_RAMNET_SSSE3_)
+	static const bool ssse3 = (__builtin_cpu_init(), __builtin_cpu_supports("ssse3") != 0);
+	return ssse3;
+#else
+	return false;
+#endif
+}
+
+#if defined(_RAMNET_AVX2_)
+#define _RAMNET_PICK_(name) (_cpu_has_avx2() ? name##_avx2 : name##_sse2)
+#elif defined(__SSE2__)
+#define _RAMNET_PICK_(name) (name##_sse2)
+#else
+#define _RAMNET_PICK_(name) (name##_scalar)
+#endif
+
+// for kernels that need pshufb, which sse2 doesn't have
+#if defined(_RAMNET_AVX2_)
+#define _RAMNET_PICK_SSSE3_(name) (_cpu_has_avx2() ? name##_avx2 : (_cpu_has_ssse3() ? name##_ssse3 : name##_scalar))
+#else
+#define _RAMNET_PICK_SSSE3_(name) (name##_scalar)
+#endif
+
+// the best kernel for this cpu is looked up once, on first use
+void ascii_upper(char *p, size_t n)
+{
+	static const byte_kernel kernel = _RAMNET_PICK_(_ascii_upper);
+	kernel(p, n);
+}
+
+void ascii_lower(char *p, size_t n)
+{
+	static const byte_kernel kernel = _RAMNET_PICK_(_ascii_lower);
+	kernel(p, n);
+}
+
+void ascii_rot13(char *p, size_t n)
+{
+	static const byte_kernel kernel = _RAMNET_PICK_(_ascii_rot13);
+	kernel(p, n);
+}
+
+size_t search_short(const char *h, size_t hn, const char *n, size_t nn)
+{
+	typedef size_t (*search_kernel)(const char *, size_t, const char *, size_t);
+	static const search_kernel kernel = _RAMNET_PICK_(_search_short);
+	return kernel(h, hn, n, nn);
+}
+
+size_t urlencode_into(const char *in, size_t n, char *out, bool raw)
+{
+	static const urlencode_kernel kernel = _RAMNET_PICK_(_urlencode);
+	return kernel(in, n, out, raw);
+}
+
+} // end anonymous namespace
+
+/*************************
+ * internal search stuff *
+ *************************
+*/
+
+namespace {
+
+// needles up to this long go through the simd first/last byte filter, longer ones use two-way.
+// the filter is quicker on real text, two-way guarantees linear time no matter what the input looks like.
+const size_t SEARCH_SHORT_NEEDLE = 32;
+
+// bytes of haystack stripos() folds to lowercase at a time
+const size_t STRIPOS_CHUNK = 65536;
+
+// two-way string matching (Crochemore & Perrin) needs a critical factorization of the needle.
+// this finds it from the two maximal suffixes of the needle, under both byte orderings.
+// returns the split position and stores the period of the right half in period.
+size_t _critical_factorization(const unsigned char *n, size_t nn, size_t &period)
+{
+	size_t max_suffix, max_suffix_rev, j, k, p;
+
+	max_suffix = (size_t)-1;
+	j = 0;
+	k = p = 1;
+	while(j + k < nn)
+	{
+		unsigned char a = n[j + k];
+		unsigned char b = n[max_suffix + k];
+		if(a < b) { j += k; k = 1; p = j - max_suffix; }
+		else if(a == b) { if(k != p) { k++; } else { j += p; k = 1; } }
+		else { max_suffix = j++; k = p = 1; }
+	}
+	period = p;
+
+	max_suffix_rev = (size_t)-1;
+	j = 0;
+	k = p = 1;
+	while(j + k < nn)
+	{
+		unsigned char a = n[j + k];
+		unsigned char b = n[max_suffix_rev + k];
+		if(b < a) { j += k; k = 1; p = j - max_suffix_rev; }
+		else if(a == b) { if(k != p) { k++; } else { j += p; k = 1; } }
+		else { max_suffix_rev = j++; k = p = 1; }
+	}
+
+	if(max_suffix_rev + 1 < max_suffix + 1)
+	{
+		return max_suffix + 1;
+	}
+	period = p;
+	return max_suffix_rev + 1;
+}
+
+// fills in the two-way factorization of a compiled needle
+void _two_way_prepare(str_needle &needle)
+{
+	const unsigned char *n = (const unsigned char *)needle.needle.data();
+	size_t nn = needle.needle.size();
+	needle.suffix = _critical_factorization(n, nn, needle.period);
+	needle.periodic = memcmp(n, n + needle.period, needle.suffix) == 0;
+	if(needle.periodic == false)
+	{
+		needle.period = std::max(needle.suffix, nn - needle.suffix) + 1;
+	}
+}
+
+size_t _two_way(const char *hs, size_t hn, const str_needle &needle)
+{
+	const unsigned char *h = (const unsigned char *)hs;
+	const unsigned char *n = (const unsigned char *)needle.needle.data();
+	size_t nn = needle.needle.size();
+	size_t suffix = needle.suffix;
+	size_t period = needle.period;
+	size_t i, j;
+
+	if(needle.periodic)
+	{
+		// the left half repeats inside the right half, so after a full match only the new part has to be compared.
+		size_t memory = 0;
+		j = 0;
+		while(j <= hn - nn)
+		{
+			i = std::max(suffix, memory);
+			while(i < nn && n[i] == h[i + j]) { i++; }
+			if(i >= nn)
+			{
+				i = suffix - 1;
+				while(memory < i + 1 && n[i] == h[i + j]) { i--; }
+				if(i + 1 < memory + 1)
+				{
+					return j;
+				}
+				j += period;
+				memory = nn - period;
+			}
+			else
+			{
+				j += i - suffix + 1;
+				memory = 0;
+			}
+		}
+		return std::string::npos;
+	}
+
+	j = 0;
+	while(j <= hn - nn)
+	{
+		i = suffix;
+		while(i < nn && n[i] == h[i + j]) { i++; }
+		if(i >= nn)
+		{
+			i = suffix - 1;
+			while(i != (size_t)-1 && n[i] == h[i + j]) { i--; }
+			if(i == (size_t)-1)
+			{
+				return j;
+			}
+			j += period;
+		}
+		else
+		{
+			j += i - suffix + 1;
+		}
+	}
+	return std::string::npos;
+}
+
+// the search engine behind strpos() and friends. returns the offset of needle in haystack, or npos.
+// compiled is only looked at for long needles, pass NULL to factorize the needle on the spot.
+size_t _strpos(const char *h, size_t hn, const char *n, size_t nn, const str_needle *compiled)
+{
+	if(nn == 0)
+	{
+		return 0;
+	}
+	if(nn > hn)
+	{
+		return std::string::npos;
+	}
+	if(nn == 1)
+	{
+		const char *p = (const char *)memchr(h, n[0], hn);
+		return p == NULL ? std::string::npos : p - h;
+	}
+	if(nn <= SEARCH_SHORT_NEEDLE)
+	{
+		return search_short(h, hn, n, nn);
+	}
+	if(compiled != NULL)
+	{
+		return _two_way(h, hn, *compiled);
+	}
+	str_needle needle;
+	needle.needle.assign(n, nn);
+	_two_way_prepare(needle);
+	return _two_way(h, hn, needle);
+}
+
+// std::string flavoured _strpos(), with the offset handling every caller wants
+size_t _strpos(const std::string &haystack, const std::string &needle, size_t offset, const str_needle *compiled = NULL)
+{
+	if(offset > haystack.size())
+	{
+		return std::string::npos;
+	}
+	size_t found = _strpos(haystack.data() + offset, haystack.size() - offset, needle.data(), needle.size(), compiled);
+	return found == std::string::npos ? found : offset + found;
+}
+
+size_t _substr_count(const std::string &haystack, const std::string &needle, const str_needle *compiled)
+{
+	size_t count = 0;
+	if(needle.empty())
+	{
+		return 0;
+	}
+	for(size_t pos = _strpos(haystack, needle, 0, compiled); pos != std::string::npos; pos = _strpos(haystack, needle, pos + needle.size(), compiled))
+	{
+		count++;
+	}
+	return count;
+}
+
+} // end anonymous namespace
+
+/****************
+ * base64 stuff *
+ ****************
+*/
+
+namespace {
+
+// the two alphabets only differ in the last two characters. the url safe one pads with '.' like base64.cpp does.
+const char BASE64_CHARS[2][65] = {
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"
+};
+
+// 6 bit value of every byte, 255 for anything that isn't base64. both alphabets are accepted, like base64.cpp.
+const unsigned char BASE64_DECODE[256] = {
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 62, 255, 62, 255, 63,
+	52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 255, 255, 255, 255, 255, 255,
+	255, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+	15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 255, 255, 255, 255, 63,
+	255, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+	41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+};
+
+// encode kernels turn whole 3 byte groups into 4 characters and return how many input bytes they used.
+// padding is left to the caller.
+typedef size_t (*base64_encode_kernel)(const unsigned char *, size_t, char *, bool);
+
+// decode kernels turn whole 4 character groups into 3 bytes and stop at the first group with anything
+// but an alphabet character in it (padding, line breaks, garbage). they return how many characters they used.
+// the simd ones store a few bytes past the end of what they decode, out needs 8 bytes of slack.
+typedef size_t (*base64_decode_kernel)(const char *, size_t, unsigned char *);
+
+size_t _base64_encode_scalar(const unsigned char *in, size_t n, char *out, bool url)
+{
+	const char *chars = BASE64_CHARS[url];
+	size_t i = 0;
+	for(; i + 3 <= n; i += 3)
+	{
+		unsigned int group = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+		out[0] = chars[group >> 18];
+		out[1] = chars[(group >> 12) & 0x3f];
+		out[2] = chars[(group >> 6) & 0x3f];
+		out[3] = chars[group & 0x3f];
+		out = out + 4;
+	}
+	return i;
+}
+
+size_t _base64_decode_scalar(const char *in, size_t n, unsigned char *out)
+{
+	const unsigned char *p = (const unsigned char *)in;
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+	{
+		unsigned int a = BASE64_DECODE[p[i]];
+		unsigned int b = BASE64_DECODE[p[i + 1]];
+		unsigned int c = BASE64_DECODE[p[i + 2]];
+		unsigned int d = BASE64_DECODE[p[i + 3]];
+		// 255 is the only entry with the high bit set
+		if(((a | b | c | d) & 0x80) != 0)
+		{
+			break;
+		}
+		unsigned int group = (a << 18) | (b << 12) | (c << 6) | d;
+		out[0] = group >> 16;
+		out[1] = group >> 8;
+		out[2] = group;
+		out = out + 3;
+	}
+	return i;
+}
+
+#if defined(_RAMNET_SSSE3_)
+
+// 12 bytes in the low 12 bytes of v become 16 six bit values, one per byte, in output order.
+// each 3 byte group is spread over a 32 bit lane and the multiplies shift the four fields into place.
+_RAMNET_SSSE3_ inline __m128i _base64_split_ssse3(__m128i v)
+{
+	v = _mm_shuffle_epi8(v, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+	__m128i ac = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+	__m128i bd = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+	return _mm_or_si128(ac, bd);
+}
+
+// six bit values to characters. every range of the alphabet is the value plus a fixed offset,
+// so we work out which range each byte is in and look its offset up with pshufb.
+_RAMNET_SSSE3_ inline __m128i _base64_chars_ssse3(__m128i v, __m128i offsets)
+{
+	__m128i range = _mm_subs_epu8(v, _mm_set1_epi8(51));
+	range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), v), _mm_set1_epi8(13)));
+	return _mm_add_epi8(v, _mm_shuffle_epi8(offsets, range));
+}
+
+_RAMNET_SSSE3_ inline __m128i _base64_offsets_ssse3(bool url)
+{
+	char c62 = BASE64_CHARS[url][62];
+	char c63 = BASE64_CHARS[url][63];
+	return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, c62 - 62, c63 - 63, 'A', 0, 0);
+}
+
+// characters to six bit values, and false in ok if any of them isn't in either alphabet
+_RAMNET_SSSE3_ inline __m128i _base64_values_ssse3(__m128i v, bool &ok)
+{
+	__m128i upper = _sse2_in_range(v, 'A', 26);
+	__m128i lower = _sse2_in_range(v, 'a', 26);
+	__m128i digit = _sse2_in_range(v, '0', 10);
+	__m128i c62 = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('+')), _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+	__m128i c63 = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+	__m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(c62, c63)));
+	ok = _mm_movemask_epi8(valid) == 0xffff;
+
+	__m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+	shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+	shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+	__m128i result = _mm_add_epi8(v, shift);
+	result = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(c62, c63), result), _mm_and_si128(c62, _mm_set1_epi8(62)));
+	return _mm_or_si128(result, _mm_and_si128(c63, _mm_set1_epi8(63)));
+}
+
+// 16 six bit values to 12 bytes, in the low 12 bytes of the result
+_RAMNET_SSSE3_ inline __m128i _base64_join_ssse3(__m128i v)
+{
+	v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+	v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+	return _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+_RAMNET_SSSE3_ size_t _base64_encode_ssse3(const unsigned char *in, size_t n, char *out, bool url)
+{
+	__m128i offsets = _base64_offsets_ssse3(url);
+	size_t i = 0;
+	// 16 bytes are loaded for every 12 used, so stop while there are still 16 left to read
+	for(; i + 16 <= n; i += 12)
+	{
+		__m128i v = _base64_split_ssse3(_mm_loadu_si128((const __m128i *)(in + i)));
+		_mm_storeu_si128((__m128i *)(out + i / 3 * 4), _base64_chars_ssse3(v, offsets));
+	}
+	return i + _base64_encode_scalar(in + i, n - i, out + i / 3 * 4, url);
+}
+
+_RAMNET_SSSE3_ size_t _base64_decode_ssse3(const char *in, size_t n, unsigned char *out)
+{
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16)
+	{
+		bool ok;
+		__m128i v = _base64_values_ssse3(_mm_loadu_si128((const __m128i *)(in + i)), ok);
+		if(ok == false)
+		{
+			break;
+		}
+		_mm_storeu_si128((__m128i *)(out + i / 4 * 3), _base64_join_ssse3(v));
+	}
+	return i + _base64_decode_scalar(in + i, n - i, out + i / 4 * 3);
+}
+
+#endif
+
+#if defined(_RAMNET_AVX2_)
+
+// the same steps as the ssse3 kernels, two 12 byte groups at a time, one per 128 bit lane
+_RAMNET_AVX2_ size_t _base64_encode_avx2(const unsigned char *in, size_t n, char *out, bool url)
+{
+	__m256i offsets = _mm256_broadcastsi128_si256(_base64_offsets_ssse3(url));
+	__m256i spread = _mm256_broadcastsi128_si256(_mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+	size_t i = 0;
+	for(; i + 28 <= n; i += 24)
+	{
+		__m256i v = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + i)));
+		v = _mm256_inserti128_si256(v, _mm_loadu_si128((const __m128i *)(in + i + 12)), 1);
+		v = _mm256_shuffle_epi8(v, spread);
+		__m256i ac = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+		__m256i bd = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+		v = _mm256_or_si256(ac, bd);
+
+		__m256i range = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+		range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), v), _mm256_set1_epi8(13)));
+		v = _mm256_add_epi8(v, _mm256_shuffle_epi8(offsets, range));
+		_mm256_storeu_si256((__m256i *)(out + i / 3 * 4), v);
+	}
+	return i + _base64_encode_scalar(in + i, n - i, out + i / 3 * 4, url);
+}
+
+_RAMNET_AVX2_ size_t _base64_decode_avx2(const char *in, size_t n, unsigned char *out)
+{
+	size_t i = 0;
+	for(; i + 32 <= n; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+		__m256i upper = _avx2_in_range(v, 'A', 26);
+		__m256i lower = _avx2_in_range(v, 'a', 26);
+		__m256i digit = _avx2_in_range(v, '0', 10);
+		__m256i c62 = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('+')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')));
+		__m256i c63 = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+		__m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(c62, c63)));
+		if(_mm256_movemask_epi8(valid) != -1)
+		{
+			break;
+		}
+
+		__m256i shift = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+		shift = _mm256_or_si256(shift, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+		shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+		v = _mm256_add_epi8(v, shift);
+		v = _mm256_or_si256(_mm256_andnot_si256(_mm256_or_si256(c62, c63), v), _mm256_and_si256(c62, _mm256_set1_epi8(62)));
+		v = _mm256_or_si256(v, _mm256_and_si256(c63, _mm256_set1_epi8(63)));
+
+		v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+		v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+		v = _mm256_shuffle_epi8(v, _mm256_broadcastsi128_si256(_mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)));
+		// pull the 12 bytes of the high lane down next to the 12 of the low lane
+		v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+		_mm256_storeu_si256((__m256i *)(out + i / 4 * 3), v);
+	}
+	return i + _base64_decode_scalar(in + i, n - i, out + i / 4 * 3);
+}
+
+#endif
+
+// the best kernel for this cpu is looked up once, on first use
+size_t base64_encode_groups(const unsigned char *in, size_t n, char *out, bool url)
+{
+	static const base64_encode_kernel kernel = _RAMNET_PICK_SSSE3_(_base64_encode);
+	return kernel(in, n, out, url);
+}
+
+size_t base64_decode_groups(const char *in, size_t n, unsigned char *out)
+{
+	static const base64_decode_kernel kernel = _RAMNET_PICK_SSSE3_(_base64_decode);
+	return kernel(in, n, out);
+}
+
+// the last one or two bytes of an encoding, padded out to a whole group
+void _base64_encode_tail(const unsigned char *in, size_t n, char *out, bool url)
+{
+	const char *chars = BASE64_CHARS[url];
+	char pad = url ? '.' : '=';
+	unsigned int group = in[0] << 16;
+	if(n > 1)
+	{
+		group = group | (in[1] << 8);
+	}
+	out[0] = chars[group >> 18];
+	out[1] = chars[(group >> 12) & 0x3f];
+	out[2] = n > 1 ? chars[(group >> 6) & 0x3f] : pad;
+	out[3] = pad;
+}
+
+// decodes one group of up to 4 characters with the rules base64.cpp uses: padding ends a group early,
+// a missing one is fine, a group needs at least 2 characters. returns the bytes written, or -1 if it
+// isn't base64 with the position of the bad character (n if one is missing) in bad.
+int _base64_decode_group(const char *in, size_t n, unsigned char *out, size_t &bad)
+{
+	unsigned int a = BASE64_DECODE[(unsigned char)in[0]];
+	unsigned int b = n > 1 ? BASE64_DECODE[(unsigned char)in[1]] : 255;
+	if(a == 255 || b == 255)
+	{
+		bad = a == 255 ? 0 : 1;
+		return -1;
+	}
+	out[0] = (a << 2) | (b >> 4);
+	if(n < 3 || in[2] == '=' || in[2] == '.')
+	{
+		return 1;
+	}
+	unsigned int c = BASE64_DECODE[(unsigned char)in[2]];
+	if(c == 255)
+	{
+		bad = 2;
+		return -1;
+	}
+	out[1] = ((b & 0x0f) << 4) | (c >> 2);
+	if(n < 4 || in[3] == '=' || in[3] == '.')
+	{
+		return 2;
+	}
+	unsigned int d = BASE64_DECODE[(unsigned char)in[3]];
+	if(d == 255)
+	{
+		bad = 3;
+		return -1;
+	}
+	out[2] = ((c & 0x03) << 6) | d;
+	return 3;
+}
+
+// byte for byte what base64_encode() in base64.cpp produces, without building the result one push_back() at a time
+std::string _base64_encode(const std::string &str, bool url)
+{
+	const unsigned char *in = (const unsigned char *)str.data();
+	size_t n = str.size();
+	std::string result((n + 2) / 3 * 4, '\0');
+
+	size_t i = base64_encode_groups(in, n, &result[0], url);
+	if(i < n)
+	{
+		_base64_encode_tail(in + i, n - i, &result[i / 3 * 4], url);
+	}
+	return result;
+}
+
+// base64 with a '\n' after every line characters, in a single pass over a presized result.
+// line has to be a multiple of 4. the output matches base64_encode_pem() and base64_encode_mime() in base64.cpp.
+std::string _base64_encode_lines(const std::string &str, size_t line)
+{
+	const unsigned char *in = (const unsigned char *)str.data();
+	size_t n = str.size();
+	size_t encoded = (n + 2) / 3 * 4;
+	if(encoded == 0)
+	{
+		return "";
+	}
+	// no line break after the last line
+	std::string result(encoded + (encoded - 1) / line, '\0');
+	char *out = &result[0];
+
+	size_t chunk = line / 4 * 3;
+	size_t i = 0;
+	for(; n - i > chunk; i += chunk)
+	{
+		base64_encode_groups(in + i, chunk, out, false);
+		out[line] = '\n';
+		out = out + line + 1;
+	}
+	size_t done = base64_encode_groups(in + i, n - i, out, false);
+	if(i + done < n)
+	{
+		_base64_encode_tail(in + i + done, n - i - done, out + done / 3 * 4, false);
+	}
+	return result;
+}
+
+// byte for byte what base64_decode() in base64.cpp produces, bad input throws std::runtime_error the same way.
+// use base64_decode_into() to get an error code instead.
+std::string _base64_decode(const std::string &str)
+{
+	std::string result;
+	size_t offset;
+	if(base64_decode_into(str, result, offset) != BASE64_OK)
+	{
+		throw std::runtime_error("Input is not valid base64-encoded data.");
+	}
+	return result;
+}
+
+// writes all of data to fd, retrying short writes
+bool _write_all(int fd, const char *data, size_t length)
+{
+	while(length > 0)
+	{
+		ssize_t written = write(fd, data, length);
+		if(written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(written <= 0)
+		{
+			return false;
+		}
+		data = data + written;
+		length = length - written;
+	}
+	return true;
+}
+
+} // end anonymous namespace
+
+std::string __base64_encode(const std::string &str)
+{
+	return _base64_encode(str, false);
+}
+
+// the url and filename safe alphabet ('-' and '_'), padded with '.' the way base64.cpp does it
+std::string base64_encode_url(const std::string &str)
+{
+	return _base64_encode(str, true);
+}
+
+// accepts both alphabets
+std::string __base64_decode(const std::string &str)
+{
+	return _base64_decode(str);
+}
+
+// 64 characters to a line, the way pem certificates and keys are written
+std::string base64_encode_pem(const std::string &str)
+{
+	return _base64_encode_lines(str, 64);
+}
+
+// 76 characters to a line, the most rfc 2045 allows in a mail body
+std::string base64_encode_mime(const std::string &str)
+{
+	return _base64_encode_lines(str, 76);
+}
+
+// base64_decode() for wrapped input, any '\r' and '\n' are skipped wherever they are.
+// bad input throws std::runtime_error like base64_decode().
+std::string base64_decode_mime(const std::string &str)
+{
+	base64_stream stream = base64_stream_init();
+	std::string result;
+	// as much as base64_decode_update() will grow it to, so it is only allocated once
+	result.reserve(str.size() / 4 * 3 + 11);
+	if(base64_decode_update(stream, str, result) == false || base64_decode_final(stream, result) == false)
+	{
+		throw std::runtime_error("Input is not valid base64-encoded data.");
+	}
+	return result;
+}
+
+// how many bytes decoding str can produce. exact for well formed input, never too small for anything else.
+size_t base64_decoded_size(const char *data, size_t length)
+{
+	if(length == 0)
+	{
+		return 0;
+	}
+	// the last group can be short and end in up to two padding characters
+	size_t tail = length % 4 == 0 ? 4 : length % 4;
+	size_t padding = 0;
+	while(padding < 2 && padding < length && (data[length - 1 - padding] == '=' || data[length - 1 - padding] == '.'))
+	{
+		padding++;
+	}
+	size_t last = tail > padding + 1 ? tail - 1 - padding : 0;
+	return (length - tail) / 4 * 3 + last;
+}
+
+size_t base64_decoded_size(const std::string &str)
+{
+	return base64_decoded_size(str.data(), str.size());
+}
+
+// validates and decodes in one pass, into out which has room for capacity bytes. nothing is allocated and
+// nothing is thrown. returns BASE64_OK with the decoded length in written, or BASE64_INVALID with the offset
+// of the bad character (length, if the input stops in the middle of a group), or BASE64_TOO_SMALL with the
+// offset of the group that didn't fit. base64_decoded_size() bytes is always enough.
+int base64_decode_into(const char *data, size_t length, char *out, size_t capacity, size_t &written, size_t &offset)
+{
+	unsigned char *p = (unsigned char *)out;
+	offset = 0;
+
+	// the simd kernels store up to 8 bytes past what they decode, so they only get as much input as keeps that inside out
+	size_t limit = capacity > 8 ? (capacity - 8) / 3 * 4 : 0;
+	size_t i = base64_decode_groups(data, std::min(length, limit), p);
+	written = i / 4 * 3;
+
+	unsigned char group[3];
+	for(; i < length; i += 4)
+	{
+		size_t bad = 0;
+		int n = _base64_decode_group(data + i, length - i, group, bad);
+		if(n < 0)
+		{
+			offset = i + bad;
+			return BASE64_INVALID;
+		}
+		if(capacity - written < (size_t)n)
+		{
+			offset = i;
+			return BASE64_TOO_SMALL;
+		}
+		memcpy(p + written, group, n);
+		written = written + n;
+	}
+	return BASE64_OK;
+}
+
+// decodes into out, reusing its storage. on failure out holds what was decoded before the bad character.
+int base64_decode_into(const std::string &str, std::string &out, size_t &offset)
+{
+	out.resize(base64_decoded_size(str));
+	size_t written = 0;
+	int result = base64_decode_into(str.data(), str.size(), &out[0], out.size(), written, offset);
+	out.resize(written);
+	return result;
+}
+
+// one stream does one encoding or one decoding, start a new one for the next
+base64_stream base64_stream_init(bool url /* = false */)
+{
+	base64_stream stream;
+	stream.carried = 0;
+	stream.url = url;
+	stream.failed = false;
+	return stream;
+}
+
+// encodes data and appends the result to out. up to 2 bytes that don't make a whole group are held back for the next call.
+void base64_encode_update(base64_stream &stream, const char *data, size_t length, std::string &out)
+{
+	const unsigned char *in = (const unsigned char *)data;
+	size_t start = out.size();
+	out.resize(start + (stream.carried + length) / 3 * 4);
+	char *p = &out[start];
+
+	// finish the group the last call left off
+	if(stream.carried > 0)
+	{
+		while(stream.carried < 3 && length > 0)
+		{
+			stream.carry[stream.carried++] = *in++;
+			length--;
+		}
+		if(stream.carried < 3)
+		{
+			return;
+		}
+		p = p + _base64_encode_scalar(stream.carry, 3, p, stream.url) / 3 * 4;
+		stream.carried = 0;
+	}
+
+	size_t i = base64_encode_groups(in, length, p, stream.url);
+	for(; i < length; i++)
+	{
+		stream.carry[stream.carried++] = in[i];
+	}
+}
+
+void base64_encode_update(base64_stream &stream, const std::string &chunk, std::string &out)
+{
+	base64_encode_update(stream, chunk.data(), chunk.size(), out);
+}
+
+// appends the padded last group, if there is one
+void base64_encode_final(base64_stream &stream, std::string &out)
+{
+	if(stream.carried > 0)
+	{
+		size_t start = out.size();
+		out.resize(start + 4);
+		_base64_encode_tail(stream.carry, stream.carried, &out[start], stream.url);
+		stream.carried = 0;
+	}
+}
+
+// decodes data and appends the result to out, with the same rules as base64_decode().
+// line breaks are skipped so wrapped input can be streamed as it is read.
+// returns false on input that isn't base64, the stream is no good after that.
+bool base64_decode_update(base64_stream &stream, const char *data, size_t length, std::string &out)
+{
+	if(stream.failed)
+	{
+		return false;
+	}
+	size_t start = out.size();
+	// 8 bytes of slack for the simd stores
+	out.resize(start + (stream.carried + length) / 4 * 3 + 3 + 8);
+	unsigned char *p = (unsigned char *)&out[start];
+	size_t written = 0;
+
+	size_t i = 0;
+	while(i < length)
+	{
+		if(stream.carried == 0)
+		{
+			size_t used = base64_decode_groups(data + i, length - i, p + written);
+			written = written + used / 4 * 3;
+			i = i + used;
+			if(i == length)
+			{
+				break;
+			}
+		}
+		if(data[i] != '\r' && data[i] != '\n')
+		{
+			stream.carry[stream.carried++] = data[i];
+		}
+		i++;
+		if(stream.carried == 4)
+		{
+			size_t bad;
+			int n = _base64_decode_group((const char *)stream.carry, 4, p + written, bad);
+			stream.carried = 0;
+			if(n < 0)
+			{
+				stream.failed = true;
+				break;
+			}
+			written = written + n;
+		}
+	}
+	out.resize(start + written);
+	return stream.failed == false;
+}
+
+bool base64_decode_update(base64_stream &stream, const std::string &chunk, std::string &out)
+{
+	return base64_decode_update(stream, chunk.data(), chunk.size(), out);
+}
+
+// decodes a last group that came without padding. returns false if the input as a whole wasn't base64.
+bool base64_decode_final(base64_stream &stream, std::string &out)
+{
+	if(stream.failed == false && stream.carried > 0)
+	{
+		unsigned char buf[3];
+		size_t bad;
+		int n = _base64_decode_group((const char *)stream.carry, stream.carried, buf, bad);
+		stream.carried = 0;
+		if(n < 0)
+		{
+			stream.failed = true;
+		}
+		else
+		{
+			out.append((const char *)buf, n);
+		}
+	}
+	return stream.failed == false;
+}
+
+// streams everything readable from in_fd through the encoder and into out_fd, 48 KB at a time,
+// so memory use stays the same whatever the size. works with files, pipes and sockets alike.
+// returns false on a read or write failure.
+bool base64_encode_fd(int in_fd, int out_fd, bool url /* = false */)
+{
+	base64_stream stream = base64_stream_init(url);
+	std::string out;
+	char buf[49152];
+	while(true)
+	{
+		ssize_t n = read(in_fd, buf, sizeof(buf));
+		if(n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(n < 0)
+		{
+			return false;
+		}
+		out.clear();
+		if(n == 0)
+		{
+			base64_encode_final(stream, out);
+			return _write_all(out_fd, out.data(), out.size());
+		}
+		base64_encode_update(stream, buf, n, out);
+		if(_write_all(out_fd, out.data(), out.size()) == false)
+		{
+			return false;
+		}
+	}
+}
+
+// the decoding counterpart of base64_encode_fd(), also false if the input isn't base64
+bool base64_decode_fd(int in_fd, int out_fd)
+{
+	base64_stream stream = base64_stream_init();
+	std::string out;
+	char buf[65536];
+	while(true)
+	{
+		ssize_t n = read(in_fd, buf, sizeof(buf));
+		if(n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(n < 0)
+		{
+			return false;
+		}
+		out.clear();
+		bool ok = n == 0 ? base64_decode_final(stream, out) : base64_decode_update(stream, buf, n, out);
+		if(ok == false || _write_all(out_fd, out.data(), out.size()) == false)
+		{
+			return false;
+		}
+		if(n == 0)
+		{
+			return true;
+		}
+	}
+}
+
+// base64_encode_fd() and base64_decode_fd() between two files. destination is created or truncated.
+bool base64_encode_file(const std::string &source, const std::string &destination, bool url /* = false */)
+{
+	int in_fd = open(source.c_str(), O_RDONLY);
+	if(in_fd < 0)
+	{
+		return false;
+	}
+	int out_fd = open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(out_fd < 0)
+	{
+		close(in_fd);
+		return false;
+	}
+	bool result = base64_encode_fd(in_fd, out_fd, url);
+	close(in_fd);
+	return close(out_fd) == 0 && result;
+}
+
+bool base64_decode_file(const std::string &source, const std::string &destination)
+{
+	int in_fd = open(source.c_str(), O_RDONLY);
+	if(in_fd < 0)
+	{
+		return false;
+	}
+	int out_fd = open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(out_fd < 0)
+	{
+		close(in_fd);
+		return false;
+	}
+	bool result = base64_decode_fd(in_fd, out_fd);
+	close(in_fd);
+	return close(out_fd) == 0 && result;
+}
+
+/*****************
+ * url functions *
+ *****************
+*/
+
+namespace {
+
+// urlencode() and rawurlencode(). the kernel runs twice, once to size the result exactly and once to write it.
+std::string _urlencode(const std::string &str, bool raw)
+{
+	size_t length = urlencode_into(str.data(), str.size(), NULL, raw);
+	// 32 bytes of slack for the simd stores, given back by the resize without reallocating
+	std::string result(length + 32, '\0');
+	urlencode_into(str.data(), str.size(), &result[0], raw);
+	result.resize(length);
+	return result;
+}
+
+// urldecode() and rawurldecode(). a '%' that isn't followed by two hex digits is kept as it is, like php.
+std::string _urldecode(const std::string &str, bool raw)
+{
+	const char *in = str.data();
+	size_t n = str.size();
+	// decoding never makes anything longer
+	std::string result(n, '\0');
+	char *out = &result[0];
+	for(size_t i = 0; i < n;)
+	{
+		size_t run = _url_encoded_run(in + i, n - i, raw);
+		memcpy(out, in + i, run);
+		out = out + run;
+		i = i + run;
+		if(i == n)
+		{
+			break;
+		}
+		if(in[i] == '+')
+		{
+			*out++ = ' ';
+			i++;
+		}
+		else if(i + 2 < n && _hex_value(in[i + 1]) >= 0 && _hex_value(in[i + 2]) >= 0)
+		{
+			*out++ = (_hex_value(in[i + 1]) << 4) | _hex_value(in[i + 2]);
+			i = i + 3;
+		}
+		else
+		{
+			*out++ = '%';
+			i++;
+		}
+	}
+	result.resize(out - result.data());
+	return result;
+}
+
+} // end anonymous namespace
+
+// encodes str for a query string the way html forms do: letters, digits and "-_." stay, space becomes '+',
+// everything else becomes %XX
+std::string urlencode(const std::string &str)
+{
+	return _urlencode(str, false);
+}
+
+// rfc 3986 encoding for url paths: letters, digits and "-_.~" stay, everything else becomes %XX
+std::string rawurlencode(const std::string &str)
+{
+	return _urlencode(str, true);
+}
+
+// the reverse of urlencode(), '+' decodes to a space
+std::string urldecode(const std::string &str)
+{
+	return _urldecode(str, false);
+}
+
+// the reverse of rawurlencode(), '+' stays a '+'
+std::string rawurldecode(const std::string &str)
+{
+	return _urldecode(str, true);
+}
+
+/*********************
+ * process functions *
+**********************
+*/
+
+struct popen2
+{
+	pid_t child_pid;
+	int from_child, to_child;
+};
+
+struct shell_exec
+{
+	int status;
+	std::string output;
+};
+
+int popen2(const char *cmdline, struct popen2 *childinfo)
+{
+	pid_t p;
+	int pipe_stdin[2], pipe_stdout[2];
+
+	if(pipe(pipe_stdin)) return -1;
+	if(pipe(pipe_stdout)) return -1;
+
+	p = fork();
+	if(p < 0) return p; /* fork failed */
+	if(p == 0)
+	{
+		/* child */
+		close(pipe_stdin[1]);
+		dup2(pipe_stdin[0], 0);
+		close(pipe_stdout[0]);
+		dup2(pipe_stdout[1], 1);
+		execl("/bin/sh", "sh", "-c", cmdline, NULL);
+		perror("execl");
+		exit(EXIT_FAILURE);
+	}
+	childinfo->child_pid = p;
+	childinfo->to_child = pipe_stdin[1];
+	childinfo->from_child = pipe_stdout[0];
+	return 0;
+}
+
+// simple wrapper around popen2()
+// ensures process terminatation after timeout seconds. timeout 0 runs forever.
+std::string shell_exec(const std::string &cmd, const std::string &input, int &status, int timeout)
+{
+	char buf[8192];
+	struct popen2 kid;
+	popen2(cmd.c_str(), &kid);
+	write(kid.to_child, input.c_str(), input.length());
+	close(kid.to_child);
+	memset(buf, 0, 8192);
+
+	if(timeout > 0)
+	{
+		timeout = timeout * 10;
+		for(int i = 0; i < timeout; i++)
+		{
+			if(waitpid(kid.child_pid, &status, WNOHANG) != 0)
+			{
+				// process finished before timeout.
+				break;
+			}
+			usleep(100000); // 0.1 second
+		}
+		if(waitpid(kid.child_pid, &status, WNOHANG) == 0)
+		{
+			// process still running. kill it.
+			kill(kid.child_pid, SIGTERM);
+			usleep(100000);
+			if(waitpid(kid.child_pid, &status, WNOHANG) == 0)
+			{
+				kill(kid.child_pid, SIGKILL);
+			}
+		}
+	}
+
+	// wait for and reap the child
+	waitpid(kid.child_pid, &status, 0);
+
+	// collect all of the output from child, do not block
+	fcntl(kid.from_child, F_SETFL, O_NONBLOCK);
+	read(kid.from_child, buf, 8192);
+	close(kid.from_child);
+
+	std::string output = buf;
+	status = WEXITSTATUS(status);
+
+	return output;
+}
+
+// alternative way of calling shell_exec() with fewer arguments
+std::string shell_exec(const std::string &cmd, const std::string &input, int &status)
+{
+	return shell_exec(cmd, input, status, 0);
+}
+
+// alternative way of calling shell_exec() with fewer arguments
+std::string shell_exec(const std::string &cmd, const std::string &input)
+{
+	int status;
+	return shell_exec(cmd, input, status);
+}
+
+// alternative way of calling shell_exec() with fewer arguments
+std::string shell_exec(const std::string &cmd)
+{
+	return shell_exec(cmd, "");
+}
+
+/******************
+ * math functions *
+ ******************
+*/
+
+namespace {
+
+// xoshiro256** by Blackman & Vigna. every thread has its own generator, so threads never share state or wait on each other.
+// this is fast and statistically solid, but it is not a cryptographically secure generator.
+struct xoshiro256
+{
+	unsigned long long s[4];
+	bool seeded;
+};
+
+thread_local xoshiro256 prng = { { 0, 0, 0, 0 }, false };
+
+unsigned long long _splitmix64(unsigned long long &x)
+{
+	unsigned long long z = (x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+inline unsigned long long _prng_rotl(unsigned long long x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+// expands a single seed into the full state. splitmix64 never gives us the all zero state xoshiro can't leave.
+void _prng_seed(unsigned long long seed)
+{
+	for(int i = 0; i < 4; i++)
+	{
+		prng.s[i] = _splitmix64(seed);
+	}
+	prng.seeded = true;
+}
+
+// threads that never called mt_srand() get a seed from the system on first use
+void _prng_seed_from_system()
+{
+	unsigned long long seed = 0;
+	int fd = open("/dev/urandom", O_RDONLY);
+	if(fd < 0 || read(fd, &seed, sizeof(seed)) != sizeof(seed))
+	{
+		// no urandom, mix the time with the address of this thread's state so threads still differ
+		seed = (unsigned long long)time(NULL) ^ ((unsigned long long)clock() << 32) ^ (unsigned long long)(size_t)&prng;
+	}
+	if(fd >= 0)
+	{
+		close(fd);
+	}
+	_prng_seed(seed);
+}
+
+unsigned long long _prng_next()
+{
+	if(prng.seeded == false)
+	{
+		_prng_seed_from_system();
+	}
+	unsigned long long *s = prng.s;
+	unsigned long long result = _prng_rotl(s[1] * 5, 7) * 9;
+	unsigned long long t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = _prng_rotl(s[3], 45);
+	return result;
+}
+
+// a uniform number in [0, range) without modulo bias, range 0 means the full 32 bits.
+// lemire's multiply and shift method, it only needs a division in the rare case the draw lands in the biased zone.
+// ranges past 32 bits (indexes of huge vectors) draw masked 64 bit numbers until one is in range instead,
+// which takes fewer than two draws on average and needs no 128 bit multiply.
+unsigned long long _prng_range(unsigned long long range)
+{
+	if(range > 0x100000000ULL)
+	{
+		unsigned long long mask = range - 1;
+		for(int shift = 1; shift < 64; shift = shift * 2)
+		{
+			mask |= mask >> shift;
+		}
+		unsigned long long x;
+		while((x = _prng_next() & mask) >= range)
+		{
+		}
+		return x;
+	}
+	unsigned int x = (unsigned int)(_prng_next() >> 32);
+	if(range == 0 || range == 0x100000000ULL)
+	{
+		return x;
+	}
+	unsigned long long m = (unsigned long long)x * range;
+	unsigned int low = (unsigned int)m;
+	if(low < range)
+	{
+		unsigned int threshold = (unsigned int)((0x100000000ULL - range) % range);
+		while(low < threshold)
+		{
+			x = (unsigned int)(_prng_next() >> 32);
+			m = (unsigned long long)x * range;
+			low = (unsigned int)m;
+		}
+	}
+	return (unsigned int)(m >> 32);
+}
+
+} // end anonymous namespace
+
+// seeds the random number generator of the calling thread, so it repeats the same sequence.
+// other threads are not affected. threads that never call this are seeded from /dev/urandom.
+void mt_srand(unsigned long long seed)
+{
+	_prng_seed(seed);
+}
+
+// returns a random number between min and max, both included. std::srand() has no effect on this, use mt_srand().
+int rand(const int min /* = 0 */, const int max /* = RAND_MAX */)
+{
+	if(max < min)
+	{
+		// php allows the range the wrong way around
+		return rand(max, min);
+	}
+	unsigned long long range = (unsigned long long)((long long)max - (long long)min) + 1;
+	return (int)((long long)min + _prng_range(range));
+}
+
+int random_int(int min, int max)
+{
+	return rand(min, max);
+}
+
+// count random numbers between min and max, both included
+std::vector<int> random_int(int min, int max, size_t count)
+{
+	std::vector<int> result;
+	if(max < min)
+	{
+		std::swap(min, max);
+	}
+	unsigned long long range = (unsigned long long)((long long)max - (long long)min) + 1;
+	result.reserve(count);
+	for(size_t i = 0; i < count; i++)
+	{
+		result.push_back((int)((long long)min + _prng_range(range)));
+	}
+	return result;
+}
+
+// length random bytes. unlike php these do not come from a cryptographically secure source.
+std::string random_bytes(size_t length)
+{
+	std::string result(length, '\0');
+	size_t i = 0;
+	for(; i + 8 <= length; i += 8)
+	{
+		unsigned long long r = _prng_next();
+		memcpy(&result[i], &r, 8);
+	}
+	if(i < length)
+	{
+		unsigned long long r = _prng_next();
+		memcpy(&result[i], &r, length - i);
+	}
+	return result;
+}
+
+namespace {
+
+// php treats these as whitespace around a numeric string
+const char *NUMERIC_WHITESPACE = " \t\n\r\v\f";
+
+// where the pieces of a numeric string are, as found by _scan_numeric()
+struct numeric_scan
+{
+	size_t start; // first byte of the number, after any leading whitespace
+	size_t end; // one past the last byte of the number
+	bool negative;
+	const char *int_digits;
+	size_t int_len;
+	const char *frac_digits;
+	size_t frac_len;
+	long exponent;
+	bool is_float; // has a decimal point or an exponent
+};
+
+// finds the longest number at the start of str (after leading whitespace), in php's syntax:
+// [+-] digits [. digits] [e [+-] digits], or [+-] . digits [e [+-] digits]
+// returns false if there isn't one.
+bool _scan_numeric(const std::string &str, numeric_scan &scan)
+{
+	const char *p = str.data();
+	size_t n = str.size();
+	size_t i = str.find_first_not_of(NUMERIC_WHITESPACE);
+	if(i == std::string::npos)
+	{
+		return false;
+	}
+
+	scan.start = i;
+	scan.negative = false;
+	scan.is_float = false;
+	scan.exponent = 0;
+	if(p[i] == '+' || p[i] == '-')
+	{
+		scan.negative = p[i] == '-';
+		i++;
+	}
+
+	scan.int_digits = p + i;
+	scan.int_len = _digit_run(p + i, n - i);
+	i = i + scan.int_len;
+
+	scan.frac_digits = p + i;
+	scan.frac_len = 0;
+	if(i < n && p[i] == '.')
+	{
+		size_t frac_len = _digit_run(p + i + 1, n - i - 1);
+		// a lone "." is not a number, but "5." and ".5" are
+		if(scan.int_len > 0 || frac_len > 0)
+		{
+			scan.frac_digits = p + i + 1;
+			scan.frac_len = frac_len;
+			scan.is_float = true;
+			i = i + 1 + frac_len;
+		}
+	}
+	if(scan.int_len == 0 && scan.frac_len == 0)
+	{
+		return false;
+	}
+
+	// the exponent only counts if it has digits, "1e" is the number 1 followed by junk
+	if(i < n && (p[i] == 'e' || p[i] == 'E'))
+	{
+		size_t j = i + 1;
+		bool negative_exponent = false;
+		if(j < n && (p[j] == '+' || p[j] == '-'))
+		{
+			negative_exponent = p[j] == '-';
+			j++;
+		}
+		size_t exp_len = _digit_run(p + j, n - j);
+		if(exp_len > 0)
+		{
+			long exponent = 0;
+			for(size_t k = 0; k < exp_len; k++)
+			{
+				// anything this big is already 0 or infinity, stop counting before it overflows
+				if(exponent < 100000)
+				{
+					exponent = exponent * 10 + (p[j + k] - '0');
+				}
+			}
+			scan.exponent = negative_exponent ? -exponent : exponent;
+			scan.is_float = true;
+			i = j + exp_len;
+		}
+	}
+	scan.end = i;
+	return true;
+}
+
+// parses 8 ascii digits at once, by combining neighbouring digits in pairs, then pairs of pairs, then pairs of those.
+inline unsigned long long _parse_eight_digits(const char *p)
+{
+	unsigned long long v;
+	memcpy(&v, p, 8);
+	v = ((v & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+	v = ((v & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+	return ((v & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+}
+
+// turns a run of ascii digits into an integer.
+// returns false if it doesn't fit in a long long, including the sign.
+bool _parse_int(const char *digits, size_t len, bool negative, long long &value)
+{
+	while(len > 0 && digits[0] == '0')
+	{
+		digits++;
+		len--;
+	}
+	// 19 digits always fit in an unsigned long long, so we only have to check against the signed limit at the end
+	if(len > 19)
+	{
+		return false;
+	}
+
+	unsigned long long result = 0;
+	size_t i = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	for(; i + 8 <= len; i += 8)
+	{
+		result = result * 100000000ULL + _parse_eight_digits(digits + i);
+	}
+#endif
+	for(; i < len; i++)
+	{
+		result = result * 10 + (digits[i] - '0');
+	}
+
+	unsigned long long limit = negative ? 9223372036854775808ULL : 9223372036854775807ULL;
+	if(result > limit)
+	{
+		return false;
+	}
+	// negate as unsigned, LLONG_MIN has no positive counterpart
+	value = negative ? (long long)(0 - result) : (long long)result;
+	return true;
+}
+
+// the slow and careful way to a double, for numbers the fast path can't do exactly
+double _slow_numeric_to_double(const std::string &str, const numeric_scan &scan)
+{
+	std::string number(str, scan.start, scan.end - scan.start);
+	// strtod() wants the decimal point of the current locale
+	const char *point = localeconv()->decimal_point;
+	if(point != NULL && point[0] != '.' && point[0] != '\0')
+	{
+		std::replace(number.begin(), number.end(), '.', point[0]);
+	}
+	return strtod(number.c_str(), NULL);
+}
+
+// turns a scanned number into a double.
+// when the digits fit in 53 bits and the power of ten is exactly representable, one multiply or divide
+// gives the correctly rounded result (clinger's fast path). everything else goes to strtod().
+double _numeric_to_double(const std::string &str, const numeric_scan &scan)
+{
+	static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	unsigned long long mantissa = 0;
+	size_t significant = 0;
+	long exponent = scan.exponent - (long)scan.frac_len;
+
+	for(size_t part = 0; part < 2; part++)
+	{
+		const char *digits = part == 0 ? scan.int_digits : scan.frac_digits;
+		size_t len = part == 0 ? scan.int_len : scan.frac_len;
+		for(size_t i = 0; i < len; i++)
+		{
+			if(significant == 0 && digits[i] == '0')
+			{
+				continue;
+			}
+			if(++significant > 19)
+			{
+				return _slow_numeric_to_double(str, scan);
+			}
+			mantissa = mantissa * 10 + (digits[i] - '0');
+		}
+	}
+
+	double value;
+	if(mantissa == 0)
+	{
+		value = 0.0;
+	}
+	else if(mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+	{
+		value = exponent < 0 ? (double)mantissa / powers[-exponent] : (double)mantissa * powers[exponent];
+	}
+	else
+	{
+		return _slow_numeric_to_double(str, scan);
+	}
+	return scan.negative ? -value : value;
+}
+
+} // end anonymous namespace
+
+// true if str is an integer: an optional sign followed by one or more digits, nothing else.
+bool is_int(const std::string &str)
+{
+	size_t sign = (str.empty() == false && (str[0] == '+' || str[0] == '-')) ? 1 : 0;
+	if(str.size() > sign && _digit_run(str.data() + sign, str.size() - sign) == str.size() - sign)
+	{
+		return true;
+	}
+	return false;
+}
+
+// checks and converts in one go. returns false, and leaves value alone, if str is not an integer or doesn't fit in a long long.
+bool is_int(const std::string &str, long long &value)
+{
+	if(is_int(str) == false)
+	{
+		return false;
+	}
+	bool negative = str[0] == '-';
+	size_t sign = (str[0] == '+' || str[0] == '-') ? 1 : 0;
+	return _parse_int(str.data() + sign, str.size() - sign, negative, value);
+}
+
+// true if str is a number in php's sense: integers, decimals and exponents, with optional whitespace around it.
+bool is_numeric(const std::string &str)
+{
+	double value;
+	return is_numeric(str, value);
+}
+
+// checks and converts in one go. returns false, and leaves value alone, if str is not numeric.
+bool is_numeric(const std::string &str, double &value)
+{
+	numeric_scan scan;
+	if(_scan_numeric(str, scan) == false)
+	{
+		return false;
+	}
+	if(scan.end < str.size() && str.find_first_not_of(NUMERIC_WHITESPACE, scan.end) != std::string::npos)
+	{
+		return false;
+	}
+	value = _numeric_to_double(str, scan);
+	return true;
+}
+
+// the integer value of the number at the start of str, 0 if there isn't one.
+// like php this clamps to the long long limits instead of overflowing, and "1e3" is 1000.
+// bases other than 10 (and 0, which detects 0x and 0 prefixes) are handed to strtoll().
+long long intval(const std::string &str, int base /* = 10 */)
+{
+	if(base != 10)
+	{
+		return strtoll(str.c_str(), NULL, base);
+	}
+
+	numeric_scan scan;
+	if(_scan_numeric(str, scan) == false)
+	{
+		return 0;
+	}
+	if(scan.is_float)
+	{
+		double value = _numeric_to_double(str, scan);
+		if(value != value)
+		{
+			return 0;
+		}
+		if(value >= 9223372036854775807.0)
+		{
+			return LLONG_MAX;
+		}
+		if(value <= -9223372036854775808.0)
+		{
+			return LLONG_MIN;
+		}
+		return (long long)value;
+	}
+
+	long long value;
+	if(_parse_int(scan.int_digits, scan.int_len, scan.negative, value) == false)
+	{
+		return scan.negative ? LLONG_MIN : LLONG_MAX;
+	}
+	return value;
+}
+
+// the value of the number at the start of str, 0 if there isn't one.
+double floatval(const std::string &str)
+{
+	numeric_scan scan;
+	if(_scan_numeric(str, scan) == false)
+	{
+		return 0.0;
+	}
+	return _numeric_to_double(str, scan);
+}
+
+/********************
+ * string functions *
+ ********************
+*/
+
+std::string ltrim(const std::string &str, const std::string &whitespace /* = " \n\r\t\f\v" */)
+{
+	size_t start = str.find_first_not_of(whitespace);
+	if(start == std::string::npos)
+	{
+		return "";
+	}
+	return str.substr(start);
+}
+
+std::string ltrim(std::string &&str, const std::string &whitespace /* = " \n\r\t\f\v" */)
+{
+	ltrim_inplace(str, whitespace);
+	return std::move(str);
+}
+
+void ltrim_inplace(std::string &str, const std::string &whitespace /* = " \n\r\t\f\v" */)
+{
+	str.erase(0, str.find_first_not_of(whitespace));
+}
+
+std::string rtrim(const std::string &str, const std::string &whitespace /* = " \n\r\t\f\v" */)
+{
+	size_t end = str.find_last_not_of(whitespace);
+	if(end == std::string::npos)
+	{
+		return "";
+	}
+	return str.substr(0, end + 1);
+}
+
+std::string rtrim(std::string &&str, const std::string &whitespace /* = " \n\r\t\f\v" */)
+{
+	rtrim_inplace(str, whitespace);
+	return std::move(str);
+}
+
+void rtrim_inplace(std::string &str, const std::string &whitespace /* = " \n\r\t\f\v" */)
+{
+	// npos + 1 wraps around to 0, which clears a string made only of whitespace
+	str.erase(str.find_last_not_of(whitespace) + 1);
+}
+
+std::string trim(const std::string &str, const std::string &whitespace /* = " \n\r\t\f\v" */)
+{
+	size_t start = str.find_first_not_of(whitespace);
+	if(start == std::string::npos)
+	{
+		return "";
+	}
+	size_t end = str.find_last_not_of(whitespace);
+	return str.substr(start, end - start + 1);
+}
+
+std::string trim(std::string &&str, const std::string &whitespace /* = " \n\r\t\f\v" */)
+{
+	trim_inplace(str, whitespace);
+	return std::move(str);
+}
+
+void trim_inplace(std::string &str, const std::string &whitespace /* = " \n\r\t\f\v" */)
+{
+	// cut the end first so the front erase has less to move
+	rtrim_inplace(str, whitespace);
+	ltrim_inplace(str, whitespace);
+}
+
+// C++24 supposedly will have it's own std::string.contains(). In the meantime, this provides str_contains() from PHP 8
+bool str_contains(const std::string &haystack, const std::string &needle)
+{
+	if(_strpos(haystack, needle, 0) != std::string::npos)
+	{
+		return true;
+	}
+	return false;
+}
+
+bool str_contains(const std::string &haystack, const str_needle &needle)
+{
+	if(_strpos(haystack, needle.needle, 0, &needle) != std::string::npos)
+	{
+		return true;
+	}
+	return false;
+}
+
+// returns the position of the first needle in haystack at or after offset, or std::string::npos if there is none.
+// PHP returns false instead of npos, and also takes negative offsets, which we don't.
+size_t strpos(const std::string &haystack, const std::string &needle, size_t offset /* = 0 */)
+{
+	return _strpos(haystack, needle, offset);
+}
+
+size_t strpos(const std::string &haystack, const str_needle &needle, size_t offset /* = 0 */)
+{
+	return _strpos(haystack, needle.needle, offset, &needle);
+}
+
+// case insensitive strpos(), only ASCII letters are folded.
+size_t stripos(const std::string &haystack, const std::string &needle, size_t offset /* = 0 */)
+{
+	if(offset > haystack.size())
+	{
+		return std::string::npos;
+	}
+	// folding with the simd kernel beats folding byte by byte while comparing. the haystack is folded
+	// a chunk at a time, overlapping by the needle, so a match near the start never copies the rest of it.
+	if(needle.empty())
+	{
+		return offset;
+	}
+	str_needle folded(strtolower(needle));
+	std::string chunk;
+	for(size_t start = offset; ; start = start + STRIPOS_CHUNK)
+	{
+		size_t length = std::min(STRIPOS_CHUNK + folded.needle.size() - 1, haystack.size() - start);
+		chunk.assign(haystack, start, length);
+		strtolower_inplace(chunk);
+		size_t found = _strpos(chunk, folded.needle, 0, &folded);
+		if(found != std::string::npos)
+		{
+			return start + found;
+		}
+		if(start + length >= haystack.size())
+		{
+			return std::string::npos;
+		}
+	}
+}
+
+// returns the position of the last needle in haystack that starts at or after offset, or std::string::npos if there is none.
+size_t strrpos(const std::string &haystack, const std::string &needle, size_t offset /* = 0 */)
+{
+	if(offset > haystack.size() || needle.size() > haystack.size() - offset)
+	{
+		return std::string::npos;
+	}
+	if(needle.empty())
+	{
+		return haystack.size();
+	}
+	const char *h = haystack.data();
+	const char *n = needle.data();
+	size_t nn = needle.size();
+	for(size_t pos = haystack.size() - nn + 1; pos-- > offset; )
+	{
+		// check the first and last byte before paying for memcmp
+		if(h[pos] == n[0] && h[pos + nn - 1] == n[nn - 1] && memcmp(h + pos, n, nn) == 0)
+		{
+			return pos;
+		}
+	}
+	return std::string::npos;
+}
+
+// counts the non-overlapping times needle appears in haystack. an empty needle is counted as 0.
+size_t substr_count(const std::string &haystack, const std::string &needle)
+{
+	return _substr_count(haystack, needle, NULL);
+}
+
+size_t substr_count(const std::string &haystack, const str_needle &needle)
+{
+	return _substr_count(haystack, needle.needle, &needle);
+}
+
+str_needle::str_needle(const std::string &needle) : needle(needle)
+{
+	if(needle.size() > SEARCH_SHORT_NEEDLE)
+	{
+		_two_way_prepare(*this);
+	}
+}
+
+// compiles needle once, so it can be searched for in any number of haystacks without preparing it again.
+str_needle str_needle_compile(const std::string &needle)
+{
+	return str_needle(needle);
+}
+
+std::string strrev(std::string str)
+{
+	reverse(str.begin(), str.end());
+	return str;
+}
+
+std::string str_rot13(const std::string &str)
+{
+	std::string result = str;
+	str_rot13_inplace(result);
+	return result;
+}
+
+std::string str_rot13(std::string &&str)
+{
+	str_rot13_inplace(str);
+	return std::move(str);
+}
+
+void str_rot13_inplace(std::string &str)
+{
+	ascii_rot13(&str[0], str.size());
+}
+
+std::string str_repeat(const std::string &str, const size_t times)
+{
+	size_t loop;
+	std::string result;
+
+	loop = 0;
+	while(loop < times)
+	{
+		result.append(str);
+		loop++;
+	}
+	return result;
+}
+
+std::string str_pad(const std::string &input, size_t length, const std::string pad_str /* = " " */, size_t pad_type /* = STR_PAD_RIGHT */)
+{
+	std::string result;
+	result.reserve(std::max(input.size(), length));
+	result.append(input);
+	str_pad_inplace(result, length, pad_str, pad_type);
+	return result;
+}
+
+std::string str_pad(std::string &&input, size_t length, const std::string pad_str /* = " " */, size_t pad_type /* = STR_PAD_RIGHT */)
+{
+	str_pad_inplace(input, length, pad_str, pad_type);
+	return std::move(input);
+}
+
+void str_pad_inplace(std::string &input, size_t length, const std::string &pad_str /* = " " */, size_t pad_type /* = STR_PAD_RIGHT */)
+{
+	// no length available to do any padding, or nothing to pad with. leave input untouched.
+	if(input.size() >= length || pad_str.empty())
+	{
+		return;
+	}
+	if(pad_type != STR_PAD_RIGHT && pad_type != STR_PAD_LEFT && pad_type != STR_PAD_BOTH)
+	{
+		return;
+	}
+
+	size_t total = length - input.size();
+	size_t left = 0;
+	if(pad_type == STR_PAD_LEFT)
+	{
+		left = total;
+	}
+	if(pad_type == STR_PAD_BOTH)
+	{
+		// this prefers padding right, just like PHP does
+		left = total / 2;
+	}
+	size_t right = total - left;
+
+	// both sides start from the beginning of pad_str, just like PHP does
+	input.reserve(length);
+	if(left > 0)
+	{
+		input.insert(0, left, ' ');
+		for(size_t i = 0; i < left; i++)
+		{
+			input[i] = pad_str[i % pad_str.size()];
+		}
+	}
+	while(right >= pad_str.size())
+	{
+		input.append(pad_str);
+		right = right - pad_str.size();
+	}
+	input.append(pad_str, 0, right);
+}
+
+std::string ucfirst(const std::string &str)
+{
+	std::string result = str;
+	ucfirst_inplace(result);
+	return result;
+}
+
+std::string ucfirst(std::string &&str)
+{
+	ucfirst_inplace(str);
+	return std::move(str);
+}
+
+void ucfirst_inplace(std::string &str)
+{
+	if(str.empty() == false && str[0] >= 'a' && str[0] <= 'z')
+	{
+		str[0] = str[0] ^ 0x20;
+	}
+}
+
+std::string lcfirst(const std::string &str)
+{
+	std::string result = str;
+	lcfirst_inplace(result);
+	return result;
+}
+
+std::string lcfirst(std::string &&str)
+{
+	lcfirst_inplace(str);
+	return std::move(str);
+}
+
+void lcfirst_inplace(std::string &str)
+{
+	if(str.empty() == false && str[0] >= 'A' && str[0] <= 'Z')
+	{
+		str[0] = str[0] ^ 0x20;
+	}
+}
+
+std::string strtoupper(const std::string &str)
+{
+	std::string result = str;
+	strtoupper_inplace(result);
+	return result;
+}
+
+std::string strtoupper(std::string &&str)
+{
+	strtoupper_inplace(str);
+	return std::move(str);
+}
+
+void strtoupper_inplace(std::string &str)
+{
+	ascii_upper(&str[0], str.size());
+}
+
+std::string strtolower(const std::string &str)
+{
+	std::string result = str;
+	strtolower_inplace(result);
+	return result;
+}
+
+std::string strtolower(std::string &&str)
+{
+	strtolower_inplace(str);
+	return std::move(str);
+}
+
+void strtolower_inplace(std::string &str)
+{
+	ascii_lower(&str[0], str.size());
+}
+
+std::string str_replace(const std::string &search, const std::string &replace, const std::string &subject, size_t &count)
+{
+	count = 0;
+	if(search.empty())
+	{
+		// PHP: an empty search string is never found, subject is returned untouched.
+		return subject;
+	}
+
+	// count the matches first when the output can grow, so the result is allocated exactly once.
+	size_t length = subject.size();
+	if(replace.size() > search.size())
+	{
+		for(size_t pos = _strpos(subject, search, 0); pos != std::string::npos; pos = _strpos(subject, search, pos + search.size()))
+		{
+			length = length + replace.size() - search.size();
+		}
+	}
+
+	std::string result;
+	result.reserve(length);
+	size_t last = 0;
+	for(size_t pos = _strpos(subject, search, 0); pos != std::string::npos; pos = _strpos(subject, search, last))
+	{
+		result.append(subject, last, pos - last);
+		result.append(replace);
+		last = pos + search.size();
+		count++;
+	}
+	result.append(subject, last, std::string::npos);
+	return result;
 }
 
-// this depends on array behavior, so it's down here
 std::string str_replace(const std::string &search, const std::string &replace, const std::string &subject)
 {
-	std::vector<std::string> vect;
-	vect = explode(search, subject);
-	return implode(replace, vect);
+	size_t count;
+	return str_replace(search, replace, subject, count);
+}
+
+// PHP: the pairs are replaced one after another, so later search strings also see what earlier replacements put into subject.
+// strtr() replaces them all in a single pass instead.
+// like PHP, if replace has fewer entries than search the rest are replaced with an empty string, and empty search strings are ignored.
+std::string str_replace(const std::vector<std::string> &search, const std::vector<std::string> &replace, const std::string &subject, size_t &count)
+{
+	count = 0;
+	std::string result = subject;
+	for(size_t i = 0; i < search.size(); i++)
+	{
+		if(search[i].empty())
+		{
+			continue;
+		}
+		size_t replaced;
+		result = str_replace(search[i], i < replace.size() ? replace[i] : std::string(), result, replaced);
+		count = count + replaced;
+	}
+	return result;
+}
+
+std::string str_replace(const std::vector<std::string> &search, const std::vector<std::string> &replace, const std::string &subject)
+{
+	size_t count;
+	return str_replace(search, replace, subject, count);
+}
+
+// builds an aho-corasick automaton for the reversed from strings, _strtr_scan() explains why reversed.
+// if to has fewer entries than from the rest translate to an empty string, and empty from strings are ignored.
+// if the same from string is given more than once the last one wins, as it would in PHP's array_combine($from, $to).
+strtr_table strtr_compile(const std::vector<std::string> &from, const std::vector<std::string> &to)
+{
+	strtr_table t;
+	std::vector<int> fail;
+
+	// every from byte adds at most one state
+	size_t from_bytes = 0;
+	for(const std::string &needle : from)
+	{
+		from_bytes = from_bytes + needle.size();
+	}
+	t.next.reserve((from_bytes + 1) * 256);
+	t.match.reserve(from_bytes + 1);
+	fail.reserve(from_bytes + 1);
+
+	// state 0 is the root of the trie
+	t.next.assign(256, -1);
+	t.match.push_back(-1);
+	fail.push_back(0);
+
+	for(size_t i = 0; i < from.size(); i++)
+	{
+		t.length.push_back(from[i].size());
+		t.to.push_back(i < to.size() ? to[i] : "");
+		if(from[i].empty())
+		{
+			continue;
+		}
+		if(t.to[i].size() > from[i].size())
+		{
+			t.grows = true;
+		}
+		t.longest = std::max(t.longest, from[i].size());
+
+		int state = 0;
+		for(size_t j = from[i].size(); j > 0; j--)
+		{
+			unsigned char c = from[i][j - 1];
+			if(t.next[state * 256 + c] == -1)
+			{
+				t.next[state * 256 + c] = (int)t.match.size();
+				t.next.insert(t.next.end(), 256, -1);
+				t.match.push_back(-1);
+				fail.push_back(0);
+			}
+			state = t.next[state * 256 + c];
+		}
+		t.match[state] = (int)i;
+	}
+
+	// breadth first walk of the trie fills in the failure links and turns the trie into a complete dfa,
+	// so scanning never has to follow a failure link at runtime. a state that isn't a match itself takes the match
+	// of its failure state, which is the longest from string it ends with.
+	std::vector<int> queue;
+	queue.reserve(t.match.size());
+	for(int c = 0; c < 256; c++)
+	{
+		if(t.next[c] == -1)
+		{
+			t.next[c] = 0;
+		}
+		else
+		{
+			queue.push_back(t.next[c]);
+		}
+	}
+	for(size_t q = 0; q < queue.size(); q++)
+	{
+		int state = queue[q];
+		for(int c = 0; c < 256; c++)
+		{
+			int child = t.next[state * 256 + c];
+			if(child == -1)
+			{
+				t.next[state * 256 + c] = t.next[fail[state] * 256 + c];
+				continue;
+			}
+			fail[child] = t.next[fail[state] * 256 + c];
+			if(t.match[child] == -1)
+			{
+				t.match[child] = t.match[fail[child]];
+			}
+			queue.push_back(child);
+		}
+	}
+	return t;
+}
+
+namespace {
+
+// bytes of str _strtr_scan() works on at a time, blocks are made at least as long as the longest from string
+const size_t STRTR_BLOCK = 1024;
+
+// a from string found starting at a position of str
+struct strtr_match
+{
+	size_t start;
+	int index;
+};
+
+// calls found(start, index) for every from string to translate in str, left to right. as in PHP's strtr(),
+// the longest from string at the leftmost position wins and the search carries on after it,
+// so matches never overlap and translated text is never searched again.
+// running a forward automaton can't tell whether a longer match is still coming without reading ahead and then
+// going back over that text. running it backwards over a block of str finds the longest from string starting at each
+// position of the block directly, and a block only reads past its end by the longest from string. so each byte is
+// read at most twice however the from strings overlap. returns the number of matches.
+template <typename Found>
+size_t _strtr_scan(const strtr_table &t, const std::string &str, Found found)
+{
+	const unsigned char *s = (const unsigned char *)str.data();
+	size_t n = str.size();
+	size_t count = 0;
+
+	if(t.longest == 0)
+	{
+		// nothing to search for
+		return 0;
+	}
+
+	// the from strings found in the block, from its end to its start
+	strtr_match buffer[STRTR_BLOCK];
+	std::vector<strtr_match> large;
+	strtr_match *matches = buffer;
+	size_t block = STRTR_BLOCK;
+	if(t.longest > block)
+	{
+		block = t.longest;
+		large.resize(block);
+		matches = &large[0];
+	}
+	size_t i = 0;
+	while(i < n)
+	{
+		size_t begin = i;
+		size_t end = std::min(begin + block, n);
+
+		// the bytes past the block that a from string starting inside it can reach
+		int state = 0;
+		for(size_t pos = std::min(end + t.longest - 1, n); pos > end; pos--)
+		{
+			state = t.next[state * 256 + s[pos - 1]];
+		}
+		size_t found_in_block = 0;
+		for(size_t pos = end; pos > begin; pos--)
+		{
+			state = t.next[state * 256 + s[pos - 1]];
+			if(t.match[state] != -1)
+			{
+				matches[found_in_block].start = pos - 1;
+				matches[found_in_block].index = t.match[state];
+				found_in_block++;
+			}
+		}
+
+		// skip the ones that overlap a match already taken
+		while(found_in_block > 0)
+		{
+			found_in_block--;
+			const strtr_match &m = matches[found_in_block];
+			if(m.start < i)
+			{
+				continue;
+			}
+			found(m.start, m.index);
+			count++;
+			i = m.start + t.length[m.index];
+		}
+		i = std::max(i, end);
+	}
+	return count;
+}
+
+// the same translation as _strtr_scan() finds, by trying every from string at each position whose byte starts one of them.
+// there is no setup, but every from byte may be compared at each position of str. strtr() picks between the two.
+template <typename Found>
+size_t _strtr_naive_scan(const std::vector<std::string> &from, const std::string &str, Found found)
+{
+	bool starts[256] = {false};
+	for(const std::string &needle : from)
+	{
+		if(needle.empty() == false)
+		{
+			starts[(unsigned char)needle[0]] = true;
+		}
+	}
+
+	size_t count = 0;
+	size_t i = 0;
+	while(i < str.size())
+	{
+		if(starts[(unsigned char)str[i]] == false)
+		{
+			i++;
+			continue;
+		}
+		// the longest from string starting here wins, and of equal ones the last
+		int best = -1;
+		for(size_t j = 0; j < from.size(); j++)
+		{
+			size_t length = from[j].size();
+			if(length != 0 && (best == -1 || length >= from[best].size()) && length <= str.size() - i
+			&& memcmp(str.data() + i, from[j].data(), length) == 0)
+			{
+				best = (int)j;
+			}
+		}
+		if(best == -1)
+		{
+			i++;
+			continue;
+		}
+		found(i, best);
+		count++;
+		i = i + from[best].size();
+	}
+	return count;
+}
+
+} // end anonymous namespace
+
+std::string strtr(const std::string &str, const strtr_table &table, size_t &count)
+{
+	// count the matches first when the output can grow, so the result is allocated exactly once.
+	size_t length = str.size();
+	if(table.grows)
+	{
+		_strtr_scan(table, str, [&](size_t, int index) {
+			length = length + table.to[index].size() - table.length[index];
+		});
+	}
+
+	std::string result;
+	result.reserve(length);
+	size_t last = 0;
+	count = _strtr_scan(table, str, [&](size_t start, int index) {
+		result.append(str, last, start - last);
+		result.append(table.to[index]);
+		last = start + table.length[index];
+	});
+	result.append(str, last, std::string::npos);
+	return result;
+}
+
+std::string strtr(const std::string &str, const strtr_table &table)
+{
+	size_t count;
+	return strtr(str, table, count);
+}
+
+// PHP's strtr() with an array of pairs, given here as from and to. all of them are translated in a single pass over str,
+// where several from strings start at the same position the longest wins, and translated text is never searched again.
+// so unlike str_replace() with arrays, the order of the pairs only matters for duplicate from strings.
+std::string strtr(const std::string &str, const std::vector<std::string> &from, const std::vector<std::string> &to, size_t &count)
+{
+	// the automaton costs 256 transitions per from byte to build and then reads str at most twice,
+	// trying every from string costs at most every from byte per byte of str. use whichever bound is lower,
+	// strtr_compile() is the way to pay for the automaton once.
+	size_t from_bytes = 0;
+	bool grows = false;
+	for(size_t i = 0; i < from.size(); i++)
+	{
+		from_bytes = from_bytes + from[i].size();
+		if(i < to.size() && to[i].size() > from[i].size())
+		{
+			grows = true;
+		}
+	}
+	if(str.size() * from_bytes > from_bytes * 256 + str.size() * 2)
+	{
+		return strtr(str, strtr_compile(from, to), count);
+	}
+
+	// count the matches first when the output can grow, so the result is allocated exactly once.
+	static const std::string none;
+	size_t length = str.size();
+	if(grows)
+	{
+		_strtr_naive_scan(from, str, [&](size_t, int index) {
+			length = length + ((size_t)index < to.size() ? to[index] : none).size() - from[index].size();
+		});
+	}
+
+	std::string result;
+	result.reserve(length);
+	size_t last = 0;
+	count = _strtr_naive_scan(from, str, [&](size_t start, int index) {
+		result.append(str, last, start - last);
+		result.append((size_t)index < to.size() ? to[index] : none);
+		last = start + from[index].size();
+	});
+	result.append(str, last, std::string::npos);
+	return result;
+}
+
+std::string strtr(const std::string &str, const std::vector<std::string> &from, const std::vector<std::string> &to)
+{
+	size_t count;
+	return strtr(str, from, to, count);
+}
+
+// lowercase hex, two digits per byte
+std::string bin2hex(const std::string &str)
+{
+	std::string result(str.size() * 2, '\0');
+	_hex_encode((const unsigned char *)str.data(), str.size(), &result[0]);
+	return result;
+}
+
+// hex digits of either case back to bytes. returns false with out empty if str has an odd length
+// or anything that isn't a hex digit, where php's hex2bin() returns false.
+bool hex2bin(const std::string &str, std::string &out)
+{
+	out.resize(str.size() / 2);
+	if(str.size() % 2 != 0 || _hex_decode(str.data(), str.size(), (unsigned char *)&out[0]) != str.size())
+	{
+		out.clear();
+		return false;
+	}
+	return true;
+}
+
+// returns "" if str isn't hex, use the other hex2bin() to tell that apart from empty input
+std::string hex2bin(const std::string &str)
+{
+	std::string result;
+	hex2bin(str, result);
+	return result;
+}
+
+namespace {
+
+// "00" "01" ... "99", so integers can be written two digits at a time
+const char DIGIT_PAIRS[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+// writes value in decimal so that it ends just before end, and returns where it starts.
+// end needs at least 20 bytes in front of it.
+char *_format_uint(char *end, unsigned long long value)
+{
+	char *p = end;
+	while(value >= 100)
+	{
+		unsigned int pair = (unsigned int)(value % 100) * 2;
+		value = value / 100;
+		*--p = DIGIT_PAIRS[pair + 1];
+		*--p = DIGIT_PAIRS[pair];
+	}
+	if(value >= 10)
+	{
+		*--p = DIGIT_PAIRS[value * 2 + 1];
+		*--p = DIGIT_PAIRS[value * 2];
+	}
+	else
+	{
+		*--p = (char)('0' + value);
+	}
+	return p;
+}
+
+// the same for binary, octal and hex. shift is 1, 3 or 4. needs 64 bytes in front of end.
+char *_format_uint_base(char *end, unsigned long long value, int shift, bool upper)
+{
+	const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	unsigned long long mask = (1ULL << shift) - 1;
+	char *p = end;
+	do
+	{
+		*--p = digits[value & mask];
+		value = value >> shift;
+	} while(value != 0);
+	return p;
+}
+
+// formats value with snprintf() into buf and swaps the locale's decimal point for a '.' if point is true.
+// php prints exponents with as few digits as it can ("1.5e+3", not "1.5e+03"), so we trim those too.
+// for %g and %G it also keeps a ".0" on a mantissa without a point, "1.0E+25" where C prints "1E+25".
+size_t _format_double(char *buf, size_t size, const char *format, int precision, double value, bool point)
+{
+	char conversion = format[strlen(format) - 1];
+	int len = snprintf(buf, size, format, precision, value);
+	if(len < 0)
+	{
+		return 0;
+	}
+	if((size_t)len >= size)
+	{
+		len = size - 1;
+	}
+	const char *locale_point = localeconv()->decimal_point;
+	if(point && locale_point != NULL && locale_point[0] != '.' && locale_point[0] != '\0')
+	{
+		std::replace(buf, buf + len, locale_point[0], '.');
+	}
+	for(int i = 0; i < len; i++)
+	{
+		if((buf[i] == 'e' || buf[i] == 'E') && i + 2 < len)
+		{
+			int digits = i + 2;
+			int first = digits;
+			while(first < len - 1 && buf[first] == '0')
+			{
+				first++;
+			}
+			memmove(buf + digits, buf + first, len - first);
+			len = len - (first - digits);
+			if((conversion == 'g' || conversion == 'G') && memchr(buf, '.', i) == NULL && (size_t)len + 2 < size)
+			{
+				memmove(buf + i + 2, buf + i, len - i);
+				buf[i] = '.';
+				buf[i + 1] = '0';
+				len = len + 2;
+			}
+			break;
+		}
+	}
+	return len;
+}
+
+// numbers are passed to these as the string they'd print as
+long long _arg_int(const detail::format_arg &arg)
+{
+	if(arg.type == 'i') { return arg.i; }
+	if(arg.type == 'u') { return (long long)arg.u; }
+	if(arg.type == 'd')
+	{
+		if(arg.d != arg.d) { return 0; }
+		if(arg.d >= 9223372036854775807.0) { return LLONG_MAX; }
+		if(arg.d <= -9223372036854775808.0) { return LLONG_MIN; }
+		return (long long)arg.d;
+	}
+	return intval(std::string(arg.s, arg.len));
+}
+
+double _arg_double(const detail::format_arg &arg)
+{
+	if(arg.type == 'i') { return (double)arg.i; }
+	if(arg.type == 'u') { return (double)arg.u; }
+	if(arg.type == 'd') { return arg.d; }
+	return floatval(std::string(arg.s, arg.len));
+}
+
+// appends str padded out to width. php pads on the right with the pad character when left justified, even if that is a zero.
+// with zero padding the sign stays in front of the zeros.
+void _append_padded(std::string &out, const char *str, size_t len, size_t width, char pad, bool left)
+{
+	if(len >= width)
+	{
+		out.append(str, len);
+		return;
+	}
+	size_t fill = width - len;
+	if(left)
+	{
+		out.append(str, len);
+		out.append(fill, pad);
+		return;
+	}
+	if(pad == '0' && len > 0 && (str[0] == '-' || str[0] == '+'))
+	{
+		out.push_back(str[0]);
+		str++;
+		len--;
+	}
+	out.append(fill, pad);
+	out.append(str, len);
+}
+
+} // end anonymous namespace
+
+// the engine behind str_format() and str_format_append(). appends to out, so out can be cleared and reused without allocating.
+// supports php's %[argnum$][flags][width][.precision]specifier with the flags - + space 0 and 'char,
+// and the specifiers % b c d e E f F g G o s u x X.
+// a conversion with no argument left for it prints nothing.
+void detail::format_into(std::string &out, const std::string &format, const detail::format_arg *args, size_t count)
+{
+	const char *f = format.data();
+	size_t n = format.size();
+	size_t next_arg = 0;
+	char buf[512];
+
+	for(size_t i = 0; i < n; i++)
+	{
+		// copy everything up to the next conversion in one go
+		const char *percent = (const char *)memchr(f + i, '%', n - i);
+		if(percent == NULL)
+		{
+			out.append(f + i, n - i);
+			break;
+		}
+		out.append(f + i, percent - (f + i));
+		i = percent - f + 1;
+		if(i >= n)
+		{
+			break;
+		}
+		if(f[i] == '%')
+		{
+			out.push_back('%');
+			continue;
+		}
+
+		// argnum$
+		size_t arg_index = next_arg;
+		bool positional = false;
+		size_t j = i;
+		size_t num = 0;
+		while(j < n && f[j] >= '0' && f[j] <= '9')
+		{
+			num = num * 10 + (f[j] - '0');
+			j++;
+		}
+		if(j < n && f[j] == '$' && num > 0)
+		{
+			arg_index = num - 1;
+			positional = true;
+			i = j + 1;
+		}
+
+		// flags
+		bool left = false;
+		bool plus = false;
+		char pad = ' ';
+		while(i < n)
+		{
+			if(f[i] == '-') { left = true; }
+			else if(f[i] == '+') { plus = true; }
+			else if(f[i] == '0') { pad = '0'; }
+			else if(f[i] == ' ') { pad = ' '; }
+			else if(f[i] == '\'' && i + 1 < n) { pad = f[++i]; }
+			else { break; }
+			i++;
+		}
+
+		// width and precision
+		size_t width = 0;
+		while(i < n && f[i] >= '0' && f[i] <= '9')
+		{
+			width = width * 10 + (f[i] - '0');
+			i++;
+		}
+		int precision = -1;
+		if(i < n && f[i] == '.')
+		{
+			precision = 0;
+			i++;
+			while(i < n && f[i] >= '0' && f[i] <= '9')
+			{
+				precision = std::min(precision * 10 + (f[i] - '0'), 1000);
+				i++;
+			}
+		}
+		if(i >= n)
+		{
+			break;
+		}
+
+		char spec = f[i];
+		if(arg_index >= count)
+		{
+			continue;
+		}
+		const detail::format_arg &arg = args[arg_index];
+		if(positional == false)
+		{
+			next_arg++;
+		}
+
+		char *end = buf + sizeof(buf);
+		char *p = end;
+		switch(spec)
+		{
+			case 'd':
+			{
+				long long value = _arg_int(arg);
+				p = _format_uint(end, value < 0 ? 0 - (unsigned long long)value : (unsigned long long)value);
+				if(value < 0) { *--p = '-'; }
+				else if(plus) { *--p = '+'; }
+				_append_padded(out, p, end - p, width, pad, left);
+				break;
+			}
+			case 'u':
+				p = _format_uint(end, (unsigned long long)_arg_int(arg));
+				_append_padded(out, p, end - p, width, pad, left);
+				break;
+			case 'b':
+			case 'o':
+			case 'x':
+			case 'X':
+			{
+				int shift = spec == 'b' ? 1 : (spec == 'o' ? 3 : 4);
+				p = _format_uint_base(end, (unsigned long long)_arg_int(arg), shift, spec == 'X');
+				_append_padded(out, p, end - p, width, pad, left);
+				break;
+			}
+			case 'c':
+				// php ignores padding for %c
+				out.push_back((char)_arg_int(arg));
+				break;
+			case 'e':
+			case 'E':
+			case 'f':
+			case 'F':
+			case 'g':
+			case 'G':
+			{
+				const char *conversion = "%.*f";
+				if(spec == 'e') { conversion = "%.*e"; }
+				if(spec == 'E') { conversion = "%.*E"; }
+				if(spec == 'g') { conversion = "%.*g"; }
+				if(spec == 'G') { conversion = "%.*G"; }
+				double value = _arg_double(arg);
+				// only %f follows the locale, like php
+				size_t len = _format_double(buf + 1, sizeof(buf) - 1, conversion, std::min(precision < 0 ? 6 : precision, 53), value, spec != 'f');
+				p = buf + 1;
+				if(plus && value >= 0)
+				{
+					*--p = '+';
+					len++;
+				}
+				_append_padded(out, p, len, width, pad, left);
+				break;
+			}
+			case 's':
+			{
+				// numbers print the way php would turn them into a string
+				const char *str = arg.s;
+				size_t len = arg.len;
+				if(arg.type == 'd')
+				{
+					len = _format_double(buf, sizeof(buf), "%.*G", 14, arg.d, true);
+					str = buf;
+				}
+				else if(arg.type == 'u')
+				{
+					str = _format_uint(end, arg.u);
+					len = end - str;
+				}
+				else if(arg.type == 'i')
+				{
+					p = _format_uint(end, arg.i < 0 ? 0 - (unsigned long long)arg.i : (unsigned long long)arg.i);
+					if(arg.i < 0) { *--p = '-'; }
+					str = p;
+					len = end - p;
+				}
+				if(precision >= 0 && (size_t)precision < len)
+				{
+					len = precision;
+				}
+				_append_padded(out, str, len, width, pad, left);
+				break;
+			}
+			default:
+				// unknown specifier, print nothing for it
+				break;
+		}
+	}
+}
+
+// number with grouped thousands, php's rounding (half away from zero) and decimals digits after the point.
+void number_format_append(std::string &out, double num, int decimals /* = 0 */, const std::string &dec_point /* = "." */, const std::string &thousands_sep /* = "," */)
+{
+	char buf[512];
+	decimals = std::max(0, std::min(decimals, 53));
+	if(num != num || num - num != 0)
+	{
+		// nan and inf have nothing to group
+		out.append(num != num ? "nan" : (num < 0 ? "-inf" : "inf"));
+		return;
+	}
+
+	// like php, first round to 15 significant digits so that 1.005 is taken as the 1.005 it was written as.
+	// then round half away from zero at the requested decimal.
+	double scale = pow(10.0, decimals);
+	double scaled = std::fabs(num) * scale;
+	if(scaled < 1e15)
+	{
+		snprintf(buf, sizeof(buf), "%.15e", scaled);
+		scaled = std::floor(strtod(buf, NULL) + 0.5);
+	}
+	double rounded = scaled / scale;
+
+	size_t len = _format_double(buf, sizeof(buf), "%.*f", decimals, rounded, true);
+	const char *point = (const char *)memchr(buf, '.', len);
+	size_t int_len = point == NULL ? len : point - buf;
+
+	bool negative = num < 0 && scaled != 0;
+	out.reserve(out.size() + negative + len + (int_len / 3) * thousands_sep.size() + dec_point.size());
+	if(negative)
+	{
+		out.push_back('-');
+	}
+	for(size_t i = 0; i < int_len; i++)
+	{
+		if(i > 0 && (int_len - i) % 3 == 0)
+		{
+			out.append(thousands_sep);
+		}
+		out.push_back(buf[i]);
+	}
+	if(point != NULL)
+	{
+		out.append(dec_point);
+		out.append(point + 1, len - int_len - 1);
+	}
+}
+
+std::string number_format(double num, int decimals /* = 0 */, const std::string &dec_point /* = "." */, const std::string &thousands_sep /* = "," */)
+{
+	std::string result;
+	number_format_append(result, num, decimals, dec_point, thousands_sep);
+	return result;
+}
+
+/******************
+* array functions *
+*******************
+*/
+
+// walks subject one segment at a time without allocating anything.
+// pos is the cursor, it must start at 0 and is advanced past each returned segment.
+// the segment found is subject.substr(seg_pos, seg_len), which the caller may build only if it wants to.
+// eg:  size_t pos = 0, seg_pos, seg_len;
+//      while(explode_next("||", "this||is||a||string", pos, seg_pos, seg_len)) { ... }
+// returns false when there are no more segments, or if search is empty.
+bool explode_next(const std::string &search, const std::string &subject, size_t &pos, size_t &seg_pos, size_t &seg_len)
+{
+	if(search.empty() || pos == std::string::npos || pos > subject.size())
+	{
+		return false;
+	}
+	size_t found = _strpos(subject, search, pos);
+	seg_pos = pos;
+	if(found == std::string::npos)
+	{
+		// last segment, the rest of subject. the next call will return false.
+		seg_len = subject.size() - pos;
+		pos = std::string::npos;
+		return true;
+	}
+	seg_len = found - pos;
+	pos = found + search.size();
+	return true;
+}
+
+// This handles limit like php's explode() does.
+// 1) If limit is positive, the returned array will contain a maximum of limit elements with the last element containing the rest of string.
+// 2) If limit is negative, all components except the last -limit are returned.
+// 3) If limit is zero, then this is treated as 1.
+// An empty search returns an empty array (php returns false here).
+std::vector<std::string> explode(std::string const &search, std::string const &subject, int limit /* = INT_MAX */)
+{
+	std::vector<std::string> result_v;
+	size_t pos = 0;
+	size_t seg_pos;
+	size_t seg_len;
+
+	if(search.empty())
+	{
+		return result_v;
+	}
+	if(limit == 0)
+	{
+		// PHP: if the limit parameter is zero, then this is treated as 1.
+		limit = 1;
+	}
+
+	if(limit > 0)
+	{
+		while((int)result_v.size() < limit - 1 && explode_next(search, subject, pos, seg_pos, seg_len))
+		{
+			result_v.push_back(subject.substr(seg_pos, seg_len));
+		}
+		// the last element gets whatever is left of subject, delimiters and all.
+		if(pos != std::string::npos)
+		{
+			result_v.push_back(subject.substr(pos));
+		}
+		return result_v;
+	}
+
+	// negative limit, we have to know how many segments there are before we can drop any from the end.
+	// count them first so the strings we do keep get built exactly once.
+	size_t count = 0;
+	while(explode_next(search, subject, pos, seg_pos, seg_len))
+	{
+		count++;
+	}
+	size_t drop = (size_t)-(long long)limit;
+	if(drop >= count)
+	{
+		return result_v;
+	}
+	result_v.reserve(count - drop);
+	pos = 0;
+	while(result_v.size() < count - drop && explode_next(search, subject, pos, seg_pos, seg_len))
+	{
+		result_v.push_back(subject.substr(seg_pos, seg_len));
+	}
+	return result_v;
+}
+
+std::vector<std::string> str_split(const std::string &str, size_t length /* = 1 */)
+{
+	std::vector<std::string> result_v;
+	std::string result;
+	size_t loop;
+
+	if(length > str.size())
+	{
+		length = str.size();
+	}
+
+	loop = 0;
+	while(loop < str.size())
+	{
+		result = str.substr(loop, length);
+		result_v.push_back(result);
+		loop = loop + length;
+	}
+
+	return result_v;
+}
+
+std::string implode(const std::string &separator, const std::vector<std::string> &array)
+{
+	std::string result;
+	if(array.empty())
+	{
+		return result;
+	}
+
+	// work out the exact size first, so the result is allocated once
+	size_t length = separator.size() * (array.size() - 1);
+	for(size_t i = 0; i < array.size(); i++)
+	{
+		length = length + array[i].size();
+	}
+	result.reserve(length);
+
+	result.append(array[0]);
+	for(size_t i = 1; i < array.size(); i++)
+	{
+		// the separator goes in front of every piece but the first, so there is never a trailing one
+		result.append(separator);
+		result.append(array[i]);
+	}
+	return result;
+}
+
+// how much room a piece of the templated implode() needs. exact for strings, an upper bound for numbers.
+size_t detail::implode_length(const detail::format_arg &piece)
+{
+	if(piece.type == 's')
+	{
+		return piece.len;
+	}
+	if(piece.type == 'd')
+	{
+		// %.14G never needs more than this, sign and exponent included
+		return 24;
+	}
+	return 20;
+}
+
+// appends a piece of the templated implode(), numbers are written straight into out the way php prints them
+void detail::implode_append(std::string &out, const detail::format_arg &piece)
+{
+	char buf[32];
+	char *end = buf + sizeof(buf);
+	char *p;
+	switch(piece.type)
+	{
+		case 's':
+			out.append(piece.s, piece.len);
+			break;
+		case 'd':
+			out.append(buf, _format_double(buf, sizeof(buf), "%.*G", 14, piece.d, true));
+			break;
+		case 'u':
+			p = _format_uint(end, piece.u);
+			out.append(p, end - p);
+			break;
+		default:
+			p = _format_uint(end, piece.i < 0 ? 0 - (unsigned long long)piece.i : (unsigned long long)piece.i);
+			if(piece.i < 0)
+			{
+				*--p = '-';
+			}
+			out.append(p, end - p);
+			break;
+	}
+}
+
+// randomizes the order of array in place (fisher-yates)
+void shuffle(std::vector<std::string> &array)
+{
+	for(size_t i = array.size(); i > 1; i--)
+	{
+		size_t j = _prng_range(i);
+		if(j != i - 1)
+		{
+			array[i - 1].swap(array[j]);
+		}
+	}
+}
+
+// picks num distinct random indexes from array, returned in ascending order like php does.
+// returns an empty array if num is 0 or larger than array.
+std::vector<size_t> array_rand(const std::vector<std::string> &array, size_t num /* = 1 */)
+{
+	std::vector<size_t> result;
+	if(num == 0 || num > array.size())
+	{
+		return result;
+	}
+	result.reserve(num);
+	// selection sampling (knuth's algorithm s), every index gets exactly the chance it needs in a single ordered walk
+	size_t needed = num;
+	for(size_t i = 0; i < array.size() && needed > 0; i++)
+	{
+		size_t left = array.size() - i;
+		if(_prng_range(left) < needed)
+		{
+			result.push_back(i);
+			needed--;
+		}
+	}
+	return result;
+}
+
+/*********************
+ * Network functions *
+ *********************
+*/
+
+namespace
+{
+
+// milliseconds on a clock that does not jump
+long long _now_ms()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// one cached lookup, an empty address list caches a failure
+struct resolver_entry
+{
+	std::vector<struct sockaddr_storage> addresses;
+	long long expires = 0;
+};
+
+// the resolver cache is shared by every thread, so it is only touched with resolver_mutex held
+std::mutex resolver_mutex;
+std::map<std::string, resolver_entry> resolver_cache;
+int resolver_ttl = 60;
+int resolver_negative_ttl = 5;
+
+// entries kept before expired ones are dropped, and all of them if that is not enough
+const size_t RESOLVER_CACHE_SIZE = 4096;
+
+// copies the cached addresses of hostname into addresses
+// returns true on a fresh cache entry, false when hostname has to be looked up
+bool _resolve_cached(const std::string &hostname, std::vector<struct sockaddr_storage> &addresses)
+{
+	std::lock_guard<std::mutex> lock(resolver_mutex);
+	std::map<std::string, resolver_entry>::iterator cached = resolver_cache.find(hostname);
+	if(cached != resolver_cache.end() && cached->second.expires > _now_ms())
+	{
+		addresses = cached->second.addresses;
+		return true;
+	}
+	return false;
+}
+
+// the addresses of hostname in the order getaddrinfo() prefers them, from the cache while it is fresh
+std::vector<struct sockaddr_storage> _resolve(const std::string &hostname)
+{
+	std::vector<struct sockaddr_storage> cached;
+	if(_resolve_cached(hostname, cached) == true)
+	{
+		return cached;
+	}
+
+	// the lookup itself runs unlocked so one slow name does not hold up the others
+	resolver_entry entry;
+	struct addrinfo hints;
+	struct addrinfo *list = NULL;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if(getaddrinfo(hostname.c_str(), NULL, &hints, &list) == 0)
+	{
+		for(struct addrinfo *ai = list; ai != NULL; ai = ai->ai_next)
+		{
+			if((ai->ai_family == AF_INET || ai->ai_family == AF_INET6) && ai->ai_addrlen <= sizeof(struct sockaddr_storage))
+			{
+				struct sockaddr_storage address;
+				memset(&address, 0, sizeof(address));
+				memcpy(&address, ai->ai_addr, ai->ai_addrlen);
+				entry.addresses.push_back(address);
+			}
+		}
+		freeaddrinfo(list);
+	}
+
+	long long now = _now_ms();
+	std::lock_guard<std::mutex> lock(resolver_mutex);
+	int ttl = entry.addresses.empty() ? resolver_negative_ttl : resolver_ttl;
+	if(ttl > 0)
+	{
+		if(resolver_cache.size() >= RESOLVER_CACHE_SIZE)
+		{
+			for(std::map<std::string, resolver_entry>::iterator i = resolver_cache.begin(); i != resolver_cache.end(); )
+			{
+				i = i->second.expires <= now ? resolver_cache.erase(i) : std::next(i);
+			}
+			if(resolver_cache.size() >= RESOLVER_CACHE_SIZE)
+			{
+				resolver_cache.clear();
+			}
+		}
+		entry.expires = now + (long long)ttl * 1000;
+		resolver_cache[hostname] = entry;
+	}
+	return entry.addresses;
+}
+
+// the text form of an ipv4 or ipv6 address
+std::string _address_string(const struct sockaddr_storage &address)
+{
+	char text[INET6_ADDRSTRLEN];
+	const void *raw = &((const struct sockaddr_in6 *)&address)->sin6_addr;
+	if(address.ss_family == AF_INET)
+	{
+		raw = &((const struct sockaddr_in *)&address)->sin_addr;
+	}
+	if(inet_ntop(address.ss_family, raw, text, sizeof(text)) == NULL)
+	{
+		return "";
+	}
+	return text;
+}
+
+// the text form of every address
+std::vector<std::string> _address_strings(const std::vector<struct sockaddr_storage> &addresses)
+{
+	std::vector<std::string> result;
+	for(const struct sockaddr_storage &address : addresses)
+	{
+		result.push_back(_address_string(address));
+	}
+	return result;
+}
+
+}
+
+// performs a dns lookup on input and returns an IP address
+// returns input unmodified on failure.
+std::string __gethostbyname(const std::string &input)
+{
+	for(const struct sockaddr_storage &address : _resolve(input))
+	{
+		if(address.ss_family == AF_INET)
+		{
+			return _address_string(address);
+		}
+	}
+	return input;
+}
+
+// returns every ipv6 and ipv4 address of hostname, most preferred first, or an empty vector on failure.
+// answers and failures are cached, see resolver_set_ttl(). safe to call from several threads.
+std::vector<std::string> resolve(const std::string &hostname)
+{
+	return _address_strings(_resolve(hostname));
+}
+
+// resolve() every hostname, looking up to threads of the uncached ones at the same time.
+// returns the addresses of hostnames[i] at index i
+std::vector<std::vector<std::string>> resolve_batch(const std::vector<std::string> &hostnames, size_t threads)
+{
+	std::vector<std::vector<std::string>> result(hostnames.size());
+	std::vector<size_t> missing;
+	std::vector<struct sockaddr_storage> cached;
+	for(size_t i = 0; i < hostnames.size(); i++)
+	{
+		if(_resolve_cached(hostnames[i], cached) == true)
+		{
+			result[i] = _address_strings(cached);
+		}
+		else
+		{
+			missing.push_back(i);
+		}
+	}
+
+	std::atomic<size_t> next(0);
+	auto worker = [&]()
+	{
+		for(size_t i = next++; i < missing.size(); i = next++)
+		{
+			result[missing[i]] = resolve(hostnames[missing[i]]);
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for(size_t i = 1; i < threads && i < missing.size(); i++)
+	{
+		try
+		{
+			pool.emplace_back(worker);
+		}
+		catch(const std::system_error &e)
+		{
+			// out of threads, the ones already running share the work
+			break;
+		}
+	}
+	worker();
+	for(std::thread &thread : pool)
+	{
+		thread.join();
+	}
+	return result;
+}
+
+// how many seconds resolve(), sopen() and friends reuse an answer (ttl) and a failed lookup (negative_ttl).
+// 0 turns that part of the cache off. the defaults are 60 and 5 seconds
+void resolver_set_ttl(int ttl, int negative_ttl)
+{
+	std::lock_guard<std::mutex> lock(resolver_mutex);
+	resolver_ttl = ttl;
+	resolver_negative_ttl = negative_ttl;
+	resolver_cache.clear();
+}
+
+// forget every cached lookup
+void resolver_flush()
+{
+	std::lock_guard<std::mutex> lock(resolver_mutex);
+	resolver_cache.clear();
+}
+
+// similar to file_get_contents, but for the network
+// returns empty string on failure
+std::string url_get_contents(const std::string &input)
+{
+	if(input.substr(0, 7) == "http://" || input.substr(0, 8) == "https://")
+	{
+		http fetch = http_fetch(input);
+
+		if(fetch.status != 200)
+		{
+			return "";
+		}
+		return fetch.body;
+	}
+	return "";
+}
+
+namespace
+{
+
+// how long a connection attempt gets before the next address is tried alongside it,
+// the delay rfc 8305 (happy eyeballs) recommends
+const int CONNECTION_ATTEMPT_DELAY = 250;
+
+// order the resolved addresses as rfc 8305 does: keep the resolver's preference,
+// but alternate address families so a broken ipv6 (or ipv4) path only costs one attempt delay
+std::vector<struct sockaddr_storage> _interleave_families(const std::vector<struct sockaddr_storage> &addresses)
+{
+	std::vector<struct sockaddr_storage> first;
+	std::vector<struct sockaddr_storage> other;
+	for(const struct sockaddr_storage &address : addresses)
+	{
+		if(address.ss_family == addresses[0].ss_family)
+		{
+			first.push_back(address);
+		}
+		else
+		{
+			other.push_back(address);
+		}
+	}
+	std::vector<struct sockaddr_storage> ordered;
+	for(size_t i = 0; i < first.size() || i < other.size(); i++)
+	{
+		if(i < first.size())
+		{
+			ordered.push_back(first[i]);
+		}
+		if(i < other.size())
+		{
+			ordered.push_back(other[i]);
+		}
+	}
+	return ordered;
+}
+
+// start a non-blocking connect() to one address
+// returns the socket fd, or -1 when the attempt failed straight away
+int _connect_start(const struct sockaddr_storage &address, bool &connected)
+{
+	int sock = socket(address.ss_family, SOCK_STREAM, 0);
+	if(sock < 0)
+	{
+		return -1;
+	}
+	fcntl(sock, F_SETFD, FD_CLOEXEC);
+	if(fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK) < 0)
+	{
+		close(sock);
+		return -1;
+	}
+	socklen_t length = address.ss_family == AF_INET ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+	connected = connect(sock, (const struct sockaddr *)&address, length) == 0;
+	if(connected == false && errno != EINPROGRESS)
+	{
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+// race connections to the addresses, starting the next one every CONNECTION_ATTEMPT_DELAY ms
+// or as soon as an attempt fails. the first socket to connect wins and the others are closed.
+// timeout is in milliseconds for the whole race, 0 waits as long as the attempts take.
+// returns a connected blocking socket fd, or -1 on failure
+int _connect_race(const std::vector<struct sockaddr_storage> &resolved, int timeout)
+{
+	std::vector<struct sockaddr_storage> addresses = _interleave_families(resolved);
+	std::vector<struct pollfd> attempts;
+	size_t next = 0;
+	long long deadline = _now_ms() + timeout;
+	long long next_start = 0;
+	int winner = -1;
+
+	while(winner == -1)
+	{
+		long long now = _now_ms();
+		if(timeout > 0 && now >= deadline)
+		{
+			break;
+		}
+		if(next < addresses.size() && (attempts.empty() || now >= next_start))
+		{
+			bool connected = false;
+			int sock = _connect_start(addresses[next++], connected);
+			if(connected == true)
+			{
+				winner = sock;
+				break;
+			}
+			if(sock != -1)
+			{
+				struct pollfd pfd;
+				pfd.fd = sock;
+				pfd.events = POLLOUT;
+				pfd.revents = 0;
+				attempts.push_back(pfd);
+				next_start = now + CONNECTION_ATTEMPT_DELAY;
+			}
+			continue;
+		}
+		if(attempts.empty())
+		{
+			break;
+		}
+
+		long long wait = -1;
+		if(next < addresses.size())
+		{
+			wait = next_start - now;
+		}
+		if(timeout > 0 && (wait == -1 || deadline - now < wait))
+		{
+			wait = deadline - now;
+		}
+		if(poll(attempts.data(), attempts.size(), (int)wait) < 0 && errno != EINTR)
+		{
+			break;
+		}
+		for(size_t i = 0; i < attempts.size(); )
+		{
+			if(attempts[i].revents == 0)
+			{
+				i++;
+				continue;
+			}
+			int error = 0;
+			socklen_t length = sizeof(error);
+			if(getsockopt(attempts[i].fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0)
+			{
+				winner = attempts[i].fd;
+				attempts.erase(attempts.begin() + i);
+				break;
+			}
+			// a failed attempt makes room for the next address right away
+			close(attempts[i].fd);
+			attempts.erase(attempts.begin() + i);
+			next_start = 0;
+		}
+	}
+
+	for(const struct pollfd &pfd : attempts)
+	{
+		close(pfd.fd);
+	}
+	if(winner != -1)
+	{
+		fcntl(winner, F_SETFL, fcntl(winner, F_GETFL) & ~O_NONBLOCK);
+	}
+	return winner;
+}
+
+}
+
+namespace
+{
+
+struct line_buffer;
+struct evloop_state;
+
+// what the library keeps about one fd: the tls state of a socket from ssl_sopen(),
+// the lines read_line() buffered, and the state of an event loop (which is an epoll fd).
+// the pointers are atomic because a closed fd number is reused by whichever thread opens the next fd,
+// they are released when the fd is closed and acquired by the next owner.
+struct fd_state
+{
+	std::atomic<struct tls *> tlsctx{NULL};
+	std::atomic<line_buffer *> lines{NULL};
+	std::atomic<evloop_state *> evloop{NULL};
+};
+
+// fd_state is looked up by fd in chunks of FD_CHUNK slots that are allocated on first use and never freed,
+// so a lookup is two loads without a lock, and threads that own different fds never share a slot.
+// this covers fds up to 1048576, the default kernel limit on open files.
+const size_t FD_CHUNK = 1024;
+const size_t FD_CHUNKS = 1024;
+std::atomic<fd_state *> fd_table[FD_CHUNKS];
+
+// the slot of fd, allocating its chunk when create is true
+// returns NULL when fd is out of range, or its chunk does not exist and create is false
+fd_state *_fd(int fd, bool create)
+{
+	if(fd < 0 || (size_t)fd >= FD_CHUNK * FD_CHUNKS)
+	{
+		return NULL;
+	}
+	std::atomic<fd_state *> &chunk = fd_table[fd / FD_CHUNK];
+	fd_state *slots = chunk.load(std::memory_order_acquire);
+	if(slots == NULL)
+	{
+		if(create == false)
+		{
+			return NULL;
+		}
+		// two threads may race to create the chunk, the loser frees its copy
+		fd_state *fresh = new fd_state[FD_CHUNK];
+		if(chunk.compare_exchange_strong(slots, fresh, std::memory_order_acq_rel) == true)
+		{
+			slots = fresh;
+		}
+		else
+		{
+			delete[] fresh;
+		}
+	}
+	return &slots[fd % FD_CHUNK];
+}
+
+// the tls context of a socket from ssl_sopen(), NULL for any other fd
+struct tls *_fd_tls(int fd)
+{
+	fd_state *slot = _fd(fd, false);
+	if(slot == NULL)
+	{
+		return NULL;
+	}
+	return slot->tlsctx.load(std::memory_order_acquire);
+}
+
+// clear the slot of an fd the library just opened. the fd number may have belonged to a socket or event loop
+// that was closed with plain close() instead of __close(), ssl_close() or evloop_destroy(), and what was kept
+// about it must not leak into the new one. defined with the event loop functions, which it needs.
+void _fd_reset(int fd);
+
+}
+
+// open tcp socket connection to hostname on port
+// returns a socket fd, or -1 on failure
+int sopen(const std::string &hostname, int port)
+{
+	// 10 minutes, for both the connection and each read or write
+	return sopen(hostname, port, 600000, 600000);
+}
+
+// open tcp socket connection to hostname on port over ipv6 or ipv4, whichever connects first.
+// connect_timeout limits the whole connection setup and timeout each later read or write,
+// both in milliseconds, 0 disables the limit.
+// returns a socket fd, or -1 on failure
+int sopen(const std::string &hostname, int port, int connect_timeout, int timeout)
+{
+	std::vector<struct sockaddr_storage> addresses = _resolve(hostname);
+	if(addresses.empty())
+	{
+		std::cerr << "hostname lookup failure!" << std::endl;
+		return -1;
+	}
+	for(struct sockaddr_storage &address : addresses)
+	{
+		if(address.ss_family == AF_INET)
+		{
+			((struct sockaddr_in *)&address)->sin_port = htons(port);
+		}
+		else
+		{
+			((struct sockaddr_in6 *)&address)->sin6_port = htons(port);
+		}
+	}
+	int sock = _connect_race(addresses, connect_timeout);
+	if(sock == -1)
+	{
+		std::cerr << "connection failed!" << std::endl;
+		return -1;
+	}
+	_fd_reset(sock);
+
+	struct timeval tv;
+	tv.tv_sec = timeout / 1000;
+	tv.tv_usec = (timeout % 1000) * 1000;
+	if(setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0
+	|| setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0)
+	{
+		std::cerr << "setsockopt failed!" << std::endl;
+	}
+	return sock;
+}
+
+namespace
+{
+
+// bytes read() is asked for at a time by read_line()
+const size_t LINE_CHUNK = 65536;
+
+// once the lines before them were returned, up to this many unread bytes move out of a chunk into a buffer of their own
+const size_t LINE_KEEP = 4096;
+
+// bytes received on a socket but not yet returned by read_line().
+// data is only a whole chunk while lines are read out of it, see _line_buffer_settle()
+struct line_buffer
+{
+	std::vector<char> data;
+	size_t start = 0;
+	size_t end = 0;
+	size_t scanned = 0;
+};
+
+// the read_line() buffer of fd, made on first use and dropped again by __close() and ssl_close()
+// returns NULL when fd is out of range
+line_buffer *_fd_lines(int fd)
+{
+	fd_state *slot = _fd(fd, true);
+	if(slot == NULL)
+	{
+		return NULL;
+	}
+	line_buffer *lines = slot->lines.load(std::memory_order_acquire);
+	if(lines == NULL)
+	{
+		lines = new line_buffer();
+		slot->lines.store(lines, std::memory_order_release);
+	}
+	return lines;
+}
+
+// returns true when read_line() buffered bytes of fd that were not returned yet
+bool _fd_has_lines(int fd)
+{
+	fd_state *slot = _fd(fd, false);
+	line_buffer *lines = slot == NULL ? NULL : slot->lines.load(std::memory_order_acquire);
+	return lines != NULL && lines->start != lines->end;
+}
+
+// drop the read_line() buffer of fd
+void _fd_drop_lines(int fd)
+{
+	fd_state *slot = _fd(fd, false);
+	if(slot != NULL)
+	{
+		delete slot->lines.exchange(NULL, std::memory_order_acq_rel);
+	}
+}
+
+// the chunk each thread reads into, lent to the socket being read and given back once the socket
+// has returned its lines. that way a socket that is waiting for more keeps only its unread bytes.
+std::vector<char> &_line_scratch()
+{
+	static thread_local std::vector<char> scratch;
+	return scratch;
+}
+
+// make room after the unread bytes, growing only when a single line does not fit
+void _line_buffer_room(line_buffer &buf)
+{
+	if(buf.data.size() < LINE_CHUNK)
+	{
+		// borrow the thread's chunk and bring along the few bytes kept so far
+		std::vector<char> &scratch = _line_scratch();
+		scratch.resize(LINE_CHUNK);
+		std::copy(buf.data.begin() + buf.start, buf.data.begin() + buf.end, scratch.begin());
+		buf.end -= buf.start;
+		buf.start = 0;
+		buf.data.swap(scratch);
+		std::vector<char>().swap(scratch);
+	}
+	else if(buf.start == buf.end)
+	{
+		buf.start = 0;
+		buf.end = 0;
+	}
+	else if(buf.end == buf.data.size())
+	{
+		if(buf.start > 0)
+		{
+			memmove(buf.data.data(), buf.data.data() + buf.start, buf.end - buf.start);
+			buf.end -= buf.start;
+			buf.start = 0;
+		}
+		else
+		{
+			buf.data.resize(buf.data.size() * 2);
+		}
+	}
+}
+
+// after read_line() returned, hand the chunk back to the thread once no unread bytes are left in it.
+// the last few bytes, or whatever waits on a socket that has nothing more to read right now, move to a buffer of their own.
+void _line_buffer_settle(line_buffer &buf, int status)
+{
+	size_t kept = buf.end - buf.start;
+	if(buf.data.size() < LINE_CHUNK || (kept != 0 && kept > LINE_KEEP && status != LINE_ERROR))
+	{
+		return;
+	}
+	std::vector<char> rest(buf.data.begin() + buf.start, buf.data.begin() + buf.end);
+	std::vector<char> &scratch = _line_scratch();
+	if(scratch.empty() && buf.data.size() == LINE_CHUNK)
+	{
+		// chunks grown for a long line are freed instead
+		scratch.swap(buf.data);
+	}
+	buf.data.swap(rest);
+	buf.start = 0;
+	buf.end = kept;
+}
+
+// the shared part of read_line() and ssl_read_line(), without _line_buffer_settle().
+// fill(data, size) gets more bytes like read() does: the count, 0 at the end of the stream or -1 on failure
+template <typename Fill>
+int _read_line_buffered(line_buffer &buf, std::string &line, size_t max_length, Fill fill)
+{
+	while(true)
+	{
+		const char *begin = buf.data.data() + buf.start;
+		size_t available = buf.end - buf.start;
+
+		// a line of max_length bytes may still be followed by \r\n
+		bool too_long = available > 1 && available - 1 > max_length;
+		size_t window = too_long ? max_length + 2 : available;
+		const char *newline = buf.scanned < window ? (const char *)memchr(begin + buf.scanned, '\n', window - buf.scanned) : NULL;
+		if(newline != NULL)
+		{
+			size_t length = newline - begin;
+			size_t next = length + 1;
+			if(length > 0 && begin[length - 1] == '\r')
+			{
+				length--;
+			}
+			if(length <= max_length)
+			{
+				line.assign(begin, length);
+				buf.start += next;
+				buf.scanned = 0;
+				return LINE_OK;
+			}
+		}
+		if(newline != NULL || too_long)
+		{
+			line.assign(begin, max_length);
+			buf.start += max_length;
+			buf.scanned = 0;
+			return LINE_TOO_LONG;
+		}
+		// remembered across calls, so a line arriving in many small reads is only searched once
+		buf.scanned = window;
+
+		_line_buffer_room(buf);
+		ssize_t n = fill(buf.data.data() + buf.end, buf.data.size() - buf.end);
+		if(n < 0)
+		{
+			line.clear();
+			return LINE_ERROR;
+		}
+		if(n == 0)
+		{
+			// the last line may not be terminated
+			size_t length = std::min(buf.end - buf.start, max_length);
+			line.assign(buf.data.data() + buf.start, length);
+			buf.start += length;
+			buf.scanned = 0;
+			if(buf.start != buf.end)
+			{
+				return LINE_TOO_LONG;
+			}
+			return length == 0 ? LINE_EOF : LINE_OK;
+		}
+		buf.end += n;
+	}
+}
+
+// the shared part of read_line() and ssl_read_line().
+// fill(data, size) gets more bytes like read() does: the count, 0 at the end of the stream or -1 on failure
+template <typename Fill>
+int _read_line(line_buffer &buf, std::string &line, size_t max_length, Fill fill)
+{
+	int status = _read_line_buffered(buf, line, max_length, fill);
+	_line_buffer_settle(buf, status);
+	return status;
+}
+
+}
+
+// read a line from socket into line, without the trailing \n or \r\n.
+// a bare \r is kept as part of the line. bytes are read in large chunks and
+// kept for the next call, so do not mix this with read() on the same socket.
+// returns LINE_OK, LINE_EOF once the peer closed the connection and every line was returned,
+// LINE_TOO_LONG with the first max_length bytes of the line (the rest is returned by the next call),
+// or LINE_ERROR when read() failed or timed out (nothing buffered is lost)
+int read_line(int sock, std::string &line, size_t max_length)
+{
+	line_buffer *buf = _fd_lines(sock);
+	if(buf == NULL)
+	{
+		line.clear();
+		return LINE_ERROR;
+	}
+	return _read_line(*buf, line, max_length, [sock](char *data, size_t size)
+	{
+		ssize_t n;
+		while((n = read(sock, data, size)) < 0 && errno == EINTR)
+		{
+		}
+		return n;
+	});
+}
+
+// read a line from socket and return it trimmed.
+// returns empty string on failure
+std::string read_line(int sock)
+{
+	std::string line;
+	int status = read_line(sock, line, LINE_MAX_LENGTH);
+	if(status == LINE_ERROR || status == LINE_EOF)
+	{
+		std::cerr << "socket failure. read failed." << std::endl;
+		return "";
+	}
+	return trim(std::move(line));
+}
+
+namespace
+{
+
+// lines per writev() in write_lines(), 1024 iovecs is the IOV_MAX of linux and the bsds
+const size_t LINES_PER_WRITEV = 512;
+
+// writev() all of iov, retrying short writes
+bool _writev_all(int fd, struct iovec *iov, int count)
+{
+	while(count > 0)
+	{
+		ssize_t written = writev(fd, iov, count);
+		if(written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(written < 0)
+		{
+			return false;
+		}
+
+		// skip what was written, finishing inside the first partly written buffer
+		while(count > 0 && (size_t)written >= iov->iov_len)
+		{
+			written = written - iov->iov_len;
+			iov++;
+			count--;
+		}
+		if(count > 0)
+		{
+			iov->iov_base = (char *)iov->iov_base + written;
+			iov->iov_len = iov->iov_len - written;
+		}
+	}
+	return true;
+}
+
+// point iov at line and the \r\n that ends it
+void _line_iovec(struct iovec *iov, const std::string &line)
+{
+	iov[0].iov_base = (void *)line.data();
+	iov[0].iov_len = line.size();
+	iov[1].iov_base = (void *)"\r\n";
+	iov[1].iov_len = 2;
+}
+
+}
+
+// write line followed by \r\n in a single writev()
+// returns true on success, false on failure
+bool write_line(int sock, const std::string &line)
+{
+	struct iovec iov[2];
+	_line_iovec(iov, line);
+	if(_writev_all(sock, iov, 2) == false)
+	{
+		std::cerr << "socket failure. write failed." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// write every line followed by \r\n, packing up to 512 lines into each writev()
+// returns true on success, false on failure
+bool write_lines(int sock, const std::vector<std::string> &lines)
+{
+	std::vector<struct iovec> iov(std::min(lines.size(), LINES_PER_WRITEV) * 2);
+	for(size_t i = 0; i < lines.size(); i += LINES_PER_WRITEV)
+	{
+		size_t count = std::min(lines.size() - i, LINES_PER_WRITEV);
+		for(size_t j = 0; j < count; j++)
+		{
+			_line_iovec(&iov[j * 2], lines[i + j]);
+		}
+		if(_writev_all(sock, iov.data(), count * 2) == false)
+		{
+			std::cerr << "socket failure. write failed." << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// turn nagle's algorithm off (true) or back on (false) for a tcp socket,
+// so small writes of request/response protocols go out without waiting for an ack.
+// returns true on success, false on failure
+bool socket_set_nodelay(int sock, bool enable)
+{
+	int value = enable;
+	return setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value)) == 0;
+}
+
+// hold back partial segments of a tcp socket while corked (true) and send them when uncorked (false),
+// so a pipelined batch of writes leaves in as few full segments as possible.
+// returns true on success, false on failure or where the platform has no such option
+bool socket_set_cork(int sock, bool enable)
+{
+	int value = enable;
+#if defined(TCP_CORK)
+	return setsockopt(sock, IPPROTO_TCP, TCP_CORK, &value, sizeof(value)) == 0;
+#elif defined(TCP_NOPUSH)
+	return setsockopt(sock, IPPROTO_TCP, TCP_NOPUSH, &value, sizeof(value)) == 0;
+#else
+	(void)sock;
+	(void)value;
+	return false;
+#endif
+}
+
+// returns the local port of a socket, which is how to find the port slisten(0) picked, or -1 on failure
+int socket_port(int sock)
+{
+	struct sockaddr_storage address;
+	socklen_t length = sizeof(address);
+	if(getsockname(sock, (struct sockaddr *)&address, &length) != 0)
+	{
+		return -1;
+	}
+	if(address.ss_family == AF_INET)
+	{
+		return ntohs(((struct sockaddr_in *)&address)->sin_port);
+	}
+	if(address.ss_family == AF_INET6)
+	{
+		return ntohs(((struct sockaddr_in6 *)&address)->sin6_port);
+	}
+	return -1;
+}
+
+namespace
+{
+
+// make a tcp socket listening on port for both ipv6 and ipv4, or for ipv4 alone where there is no ipv6.
+// reuseport lets other sockets listen on the same port, the kernel then spreads connections between them.
+// returns the socket fd, or -1 on failure
+int _listen(int port, int backlog, bool reuseport)
+{
+	int family = AF_INET6;
+	int sock = socket(AF_INET6, SOCK_STREAM, 0);
+	if(sock < 0)
+	{
+		family = AF_INET;
+		sock = socket(AF_INET, SOCK_STREAM, 0);
+	}
+	if(sock < 0)
+	{
+		std::cerr << "socket() failed!" << std::endl;
+		return -1;
+	}
+	fcntl(sock, F_SETFD, FD_CLOEXEC);
+
+	// a restarted server can bind again while connections of the last one are in TIME_WAIT
+	int on = 1;
+	setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if(reuseport == true)
+	{
+#if defined(SO_REUSEPORT)
+		if(setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0)
+#endif
+		{
+			std::cerr << "SO_REUSEPORT is not supported!" << std::endl;
+			close(sock);
+			return -1;
+		}
+	}
+
+	struct sockaddr_storage address;
+	memset(&address, 0, sizeof(address));
+	socklen_t length;
+	if(family == AF_INET6)
+	{
+		int off = 0;
+		setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+		struct sockaddr_in6 *in6 = (struct sockaddr_in6 *)&address;
+		in6->sin6_family = AF_INET6;
+		in6->sin6_addr = in6addr_any;
+		in6->sin6_port = htons(port);
+		length = sizeof(struct sockaddr_in6);
+	}
+	else
+	{
+		struct sockaddr_in *in = (struct sockaddr_in *)&address;
+		in->sin_family = AF_INET;
+		in->sin_addr.s_addr = htonl(INADDR_ANY);
+		in->sin_port = htons(port);
+		length = sizeof(struct sockaddr_in);
+	}
+	if(bind(sock, (struct sockaddr *)&address, length) != 0 || listen(sock, backlog) != 0)
+	{
+		std::cerr << "could not listen on port " << port << "!" << std::endl;
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+}
+
+// listen for tcp connections on port, over ipv6 and ipv4. port 0 picks a free port, see socket_port().
+// backlog is how many connections may wait for saccept().
+// returns the listening socket fd, or -1 on failure
+int slisten(int port, int backlog)
+{
+	return _listen(port, backlog, false);
+}
+
+// open a number of listeners on the same port with SO_REUSEPORT, for one thread each to saccept() from.
+// the kernel spreads new connections across them, so the threads never contend for one accept queue.
+// port 0 picks a free port for all of them.
+// returns the listening socket fds, or an empty vector on failure
+std::vector<int> slisten_reuseport(int port, size_t listeners, int backlog)
+{
+	std::vector<int> socks;
+	for(size_t i = 0; i < listeners; i++)
+	{
+		int sock = _listen(port, backlog, true);
+		if(sock == -1)
+		{
+			for(int open : socks)
+			{
+				close(open);
+			}
+			return std::vector<int>();
+		}
+		port = socket_port(sock);
+		socks.push_back(sock);
+	}
+	return socks;
+}
+
+// wait for a connection on a socket from slisten() and accept it
+// returns a socket fd for read_line() and write_line(), or -1 on failure
+int saccept(int listener)
+{
+	// 10 minutes for each read or write, like sopen()
+	return saccept(listener, 600000);
+}
+
+// wait for a connection on a socket from slisten() and accept it.
+// timeout limits each later read or write in milliseconds, 0 disables the limit.
+// a non-blocking listener returns -1 without a message when no connection is waiting.
+// returns a socket fd for read_line() and write_line(), or -1 on failure
+int saccept(int listener, int timeout)
+{
+	int sock;
+	// a connection reset while it waited in the queue is not an error of the listener
+	while((sock = accept(listener, NULL, NULL)) < 0 && (errno == EINTR || errno == ECONNABORTED))
+	{
+	}
+	if(sock < 0)
+	{
+		if(errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			std::cerr << "accept() failed!" << std::endl;
+		}
+		return -1;
+	}
+	fcntl(sock, F_SETFD, FD_CLOEXEC);
+	_fd_reset(sock);
+
+	struct timeval tv;
+	tv.tv_sec = timeout / 1000;
+	tv.tv_usec = (timeout % 1000) * 1000;
+	if(setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0
+	|| setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0)
+	{
+		std::cerr << "setsockopt failed!" << std::endl;
+	}
+	return sock;
+}
+
+// close socket. a socket from ssl_sopen() should be closed with ssl_close(), which tells the server first,
+// this only frees its tls state.
+void __close(int sock)
+{
+	_fd_reset(sock);
+	close(sock);
+}
+
+/*****************
+ * TLS functions *
+ *****************
+*/
+
+// the tls session state of a socket lives in its fd_state slot, see _fd()
+// which allows the external api for this to be the same as for the non-ssl function versions
+// this also properly handles having multiple ssl sockets open at the same time, in different threads too
+
+namespace
+{
+
+// the tls client settings shared by every connection to one server, see _tls_client_config()
+struct tls_client_config
+{
+	struct tls_config *config = NULL;
+	int session_fd = -1;
+
+	// libtls reads session_fd in tls_connect_socket() and rewrites it at the end of tls_handshake(),
+	// so one connection at a time holds session_mutex across both. connections made meanwhile use fallback,
+	// the same settings without a session file, and do a full handshake instead of waiting.
+	std::mutex session_mutex;
+	struct tls_config *fallback = NULL;
+
+	// tls_config_clock when the config was last handed out, the least recently used one is evicted first
+	unsigned long long used = 0;
+
+	~tls_client_config()
+	{
+		// libtls counts the connections configured with a config, those keep it until tls_free()
+		tls_config_free(config);
+		tls_config_free(fallback);
+		if(session_fd != -1)
+		{
+			close(session_fd);
+		}
+	}
+};
+
+// configs are made once per server and kept until TLS_CONFIG_CACHE_SIZE others were used more recently,
+// only touched with tls_config_mutex held. ssl_sopen() holds its own reference, so eviction never pulls
+// a config out from under a handshake.
+const size_t TLS_CONFIG_CACHE_SIZE = 64;
+std::mutex tls_config_mutex;
+std::map<std::tuple<std::string, int, bool, std::string>, std::shared_ptr<tls_client_config>> tls_configs;
+unsigned long long tls_config_clock = 0;
+bool tls_initialized = false;
+
+// a new config that checks the server as verify and ca_file ask for
+// returns NULL on failure
+struct tls_config *_tls_new_config(bool verify, const std::string &ca_file)
+{
+	struct tls_config *config = tls_config_new();
+	if(config == NULL)
+	{
+		std::cerr << "tls_config_new() failed!" << std::endl;
+		return NULL;
+	}
+	if(ca_file != "" && tls_config_set_ca_file(config, ca_file.c_str()) != 0)
+	{
+		std::cerr << "tls_config_set_ca_file() failed!" << std::endl;
+		tls_config_free(config);
+		return NULL;
+	}
+	if(verify == false)
+	{
+		// disable certificate & oscp validation
+		tls_config_insecure_noverifycert(config);
+
+		// disable server name validation
+		tls_config_insecure_noverifyname(config);
+
+		// disable checking certificate expiration
+		tls_config_insecure_noverifytime(config);
+	}
+	return config;
+}
+
+// the config for connections to hostname on port, so the ca bundle is loaded once instead of per connection.
+// every server gets its own config because libtls keeps the session of the last handshake per config
+// (in session_fd), which the next connection to that server resumes with an abbreviated handshake.
+// returns NULL on failure
+std::shared_ptr<tls_client_config> _tls_client_config(const std::string &hostname, int port, bool verify, const std::string &ca_file)
+{
+	std::lock_guard<std::mutex> lock(tls_config_mutex);
+	if(tls_initialized == false)
+	{
+		if(tls_init() != 0)
+		{
+			std::cerr << "tls_init() failed!" << std::endl;
+			return NULL;
+		}
+		tls_initialized = true;
+	}
+
+	std::tuple<std::string, int, bool, std::string> key(hostname, port, verify, ca_file);
+	std::map<std::tuple<std::string, int, bool, std::string>, std::shared_ptr<tls_client_config>>::iterator cached = tls_configs.find(key);
+	if(cached != tls_configs.end())
+	{
+		cached->second->used = ++tls_config_clock;
+		return cached->second;
+	}
+
+	std::shared_ptr<tls_client_config> entry = std::make_shared<tls_client_config>();
+	if((entry->config = _tls_new_config(verify, ca_file)) == NULL)
+	{
+		return NULL;
+	}
+
+	// libtls wants a regular file only we can read, mkstemp() makes it 0600 and it is unlinked right away.
+	// without it connections still work, they just do a full handshake every time.
+	char session_file[] = "/tmp/ramnet-tls-XXXXXX";
+	entry->session_fd = mkstemp(session_file);
+	if(entry->session_fd != -1)
+	{
+		unlink(session_file);
+		if(tls_config_set_session_fd(entry->config, entry->session_fd) != 0)
+		{
+			close(entry->session_fd);
+			entry->session_fd = -1;
+		}
+	}
+
+	if(tls_configs.size() >= TLS_CONFIG_CACHE_SIZE)
+	{
+		std::map<std::tuple<std::string, int, bool, std::string>, std::shared_ptr<tls_client_config>>::iterator oldest = tls_configs.begin();
+		for(std::map<std::tuple<std::string, int, bool, std::string>, std::shared_ptr<tls_client_config>>::iterator i = tls_configs.begin(); i != tls_configs.end(); i++)
+		{
+			if(i->second->used < oldest->second->used)
+			{
+				oldest = i;
+			}
+		}
+		tls_configs.erase(oldest);
+	}
+	entry->used = ++tls_config_clock;
+	tls_configs[key] = entry;
+	return entry;
+}
+
+// the config without a session file of entry, made the first time two connections to its server overlap
+// returns NULL on failure
+struct tls_config *_tls_fallback_config(tls_client_config &entry, bool verify, const std::string &ca_file)
+{
+	std::lock_guard<std::mutex> lock(tls_config_mutex);
+	if(entry.fallback == NULL)
+	{
+		entry.fallback = _tls_new_config(verify, ca_file);
+	}
+	return entry.fallback;
 }
 
-/******************
-* array functions *
-*******************
+}
+
+// open a tls connection to hostname on port
+// set verify false to disable all tls validation and certificate checking
+// returns a socket fd, or -1 on failure
+int ssl_sopen(const std::string &hostname, int port, bool verify)
+{
+	return ssl_sopen(hostname, port, verify, "");
+}
+
+int ssl_sopen(const std::string &hostname, int port, bool verify, const std::string &ca_file)
+{
+	// 10 minutes, the same as sopen()
+	return ssl_sopen(hostname, port, verify, ca_file, 600000, 600000);
+}
+
+// open a tls connection to hostname on port, verifying the server against the certificates in ca_file
+// (the system bundle when ca_file is empty). connections to the same server share their config and
+// resume the previous session when the server allows it, see ssl_session_resumed().
+// connect_timeout and timeout work as they do for sopen(), timeout also limits the handshake.
+// returns a socket fd, or -1 on failure
+int ssl_sopen(const std::string &hostname, int port, bool verify, const std::string &ca_file, int connect_timeout, int timeout)
+{
+	std::shared_ptr<tls_client_config> tlscfg = _tls_client_config(hostname, port, verify, ca_file);
+	if(tlscfg == NULL)
+	{
+		return -1;
+	}
+	int tlssock = sopen(hostname, port, connect_timeout, timeout);
+	if(tlssock == -1)
+	{
+		std::cerr << "error opening socket for ssl." << std::endl;
+		return -1;
+	}
+	fd_state *slot = _fd(tlssock, true);
+	if(slot == NULL)
+	{
+		std::cerr << "ssl socket fd out of range." << std::endl;
+		__close(tlssock);
+		return -1;
+	}
+	struct tls *tlsctx = tls_client();
+	if(tlsctx == NULL)
+	{
+		std::cerr << "tls_client() failed!" << std::endl;
+		__close(tlssock);
+		return -1;
+	}
+
+	// held until the handshake wrote the new session, see tls_client_config
+	std::unique_lock<std::mutex> session(tlscfg->session_mutex, std::defer_lock);
+	struct tls_config *config = tlscfg->config;
+	if(tlscfg->session_fd != -1 && session.try_lock() == false)
+	{
+		config = _tls_fallback_config(*tlscfg, verify, ca_file);
+	}
+
+	if(config == NULL)
+	{
+		std::cerr << "tls fallback config failed!" << std::endl;
+	}
+	else if(tls_configure(tlsctx, config) != 0)
+	{
+		std::cerr << "tls_configure(): " << tls_error(tlsctx) << std::endl;
+	}
+	else if(tls_connect_socket(tlsctx, tlssock, hostname.c_str()) != 0)
+	{
+		std::cerr << "tls_connect(): " << tls_error(tlsctx) << std::endl;
+	}
+	else if(tls_handshake(tlsctx) != 0)
+	{
+		std::cerr << "tls_handshake(): " << tls_error(tlsctx) << std::endl;
+	}
+	else
+	{
+		// published last, so a thread that finds the context sees it fully set up
+		slot->tlsctx.store(tlsctx, std::memory_order_release);
+		return tlssock;
+	}
+	tls_free(tlsctx);
+	__close(tlssock);
+	return -1;
+}
+
+// returns true when the handshake of tlssock resumed an earlier session instead of doing a full one
+bool ssl_session_resumed(int tlssock)
+{
+	struct tls *tlsctx = _fd_tls(tlssock);
+	return tlsctx != NULL && tls_conn_session_resumed(tlsctx) == 1;
+}
+
+namespace
+{
+
+// wait until the tls socket can make progress after TLS_WANT_POLLIN or TLS_WANT_POLLOUT.
+// gives up after the socket's own SO_RCVTIMEO or SO_SNDTIMEO, the timeout sopen() was given,
+// and waits for ever on a socket without one.
+// returns true when the socket is ready, false on timeout or failure
+bool _tls_poll(int tlssock, ssize_t want)
+{
+	struct pollfd pfd;
+	pfd.fd = tlssock;
+	pfd.events = want == TLS_WANT_POLLIN ? POLLIN : POLLOUT;
+	pfd.revents = 0;
+
+	int timeout = -1;
+	struct timeval tv;
+	socklen_t length = sizeof(tv);
+	if(getsockopt(tlssock, SOL_SOCKET, want == TLS_WANT_POLLIN ? SO_RCVTIMEO : SO_SNDTIMEO, &tv, &length) == 0
+	&& (tv.tv_sec != 0 || tv.tv_usec != 0))
+	{
+		timeout = (int)std::min((long long)tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000, (long long)INT_MAX);
+	}
+
+	int ready;
+	while((ready = poll(&pfd, 1, timeout)) < 0 && errno == EINTR)
+	{
+	}
+	return ready > 0;
+}
+
+// tls_write() all of data, waiting with poll() whenever libtls asks for it
+bool _tls_write_all(int tlssock, struct tls *tlsctx, const char *data, size_t length)
+{
+	while(length > 0)
+	{
+		ssize_t written = tls_write(tlsctx, data, length);
+		if(written == TLS_WANT_POLLIN || written == TLS_WANT_POLLOUT)
+		{
+			if(_tls_poll(tlssock, written) == false)
+			{
+				return false;
+			}
+			continue;
+		}
+		if(written <= 0)
+		{
+			return false;
+		}
+		data = data + written;
+		length = length - written;
+	}
+	return true;
+}
+
+// write buffer to a tls socket from ssl_sopen()
+// returns true on success, false on failure
+bool _ssl_write(int tlssock, const std::string &buffer)
+{
+	struct tls *tlsctx = _fd_tls(tlssock);
+	if(tlsctx == NULL || _tls_write_all(tlssock, tlsctx, buffer.data(), buffer.size()) == false)
+	{
+		std::cerr << "ssl socket failure. write failed." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+}
+
+// read a line from tls socket into line, like read_line() does for plain sockets.
+// returns LINE_OK, LINE_EOF, LINE_TOO_LONG or LINE_ERROR
+int ssl_read_line(int tlssock, std::string &line, size_t max_length)
+{
+	struct tls *tlsctx = _fd_tls(tlssock);
+	if(tlsctx == NULL)
+	{
+		line.clear();
+		return LINE_ERROR;
+	}
+
+	return _read_line(*_fd_lines(tlssock), line, max_length, [tlssock, tlsctx](char *data, size_t size)
+	{
+		while(true)
+		{
+			ssize_t n = tls_read(tlsctx, data, size);
+			if(n != TLS_WANT_POLLIN && n != TLS_WANT_POLLOUT)
+			{
+				if(n < 0)
+				{
+					std::cerr << "tls_read(): " << tls_error(tlsctx) << std::endl;
+				}
+				return n;
+			}
+			if(_tls_poll(tlssock, n) == false)
+			{
+				std::cerr << "tls_read() timed out." << std::endl;
+				return (ssize_t)-1;
+			}
+		}
+	});
+}
+
+// read a line from tls socket and return it trimmed.
+// returns empty string on failure
+std::string ssl_read_line(int tlssock)
+{
+	std::string line;
+	int status = ssl_read_line(tlssock, line, LINE_MAX_LENGTH);
+	if(status == LINE_ERROR || status == LINE_EOF)
+	{
+		std::cerr << "socket failure. read failed." << std::endl;
+		return "";
+	}
+	return trim(std::move(line));
+}
+
+// write line followed by \r\n with one tls_write(), so short lines leave as a single tls record
+// returns true on success, false on failure
+bool ssl_write_line(int tlssock, const std::string &line)
+{
+	std::string buffer;
+	buffer.reserve(line.size() + 2);
+	buffer.append(line).append("\r\n", 2);
+	return _ssl_write(tlssock, buffer);
+}
+
+// write every line followed by \r\n with one tls_write(), which libtls splits into full size records
+// returns true on success, false on failure
+bool ssl_write_lines(int tlssock, const std::vector<std::string> &lines)
+{
+	size_t length = 0;
+	for(const std::string &line : lines)
+	{
+		length = length + line.size() + 2;
+	}
+	std::string buffer;
+	buffer.reserve(length);
+	for(const std::string &line : lines)
+	{
+		buffer.append(line).append("\r\n", 2);
+	}
+	return _ssl_write(tlssock, buffer);
+}
+
+void ssl_close(int tlssock)
+{
+	fd_state *slot = _fd(tlssock, false);
+	struct tls *tlsctx = slot == NULL ? NULL : slot->tlsctx.exchange(NULL, std::memory_order_acq_rel);
+	if(tlsctx == NULL)
+	{
+		std::cerr << "ssl_close(): not a tls socket." << std::endl;
+		return;
+	}
+
+	if(tls_close(tlsctx) != 0)
+	{
+		std::cerr << "tls_close(): " << tls_error(tlsctx) << std::endl;
+	}
+	// the config is shared with the other connections to this server, see _tls_client_config()
+	tls_free(tlsctx);
+	_fd_drop_lines(tlssock);
+	close(tlssock);
+}
+
+/************************
+ * event loop functions *
+ ************************
 */
 
-namespace {
+// an event loop is an epoll instance, identified by its fd like sockets are.
+// it watches sockets from sopen() and ssl_sopen(), hands every complete line to the socket's
+// on_line callback and writes queued lines out as the socket accepts them.
+
+namespace
+{
+
+// one socket watched by an event loop
+struct evloop_connection
+{
+	struct tls *tlsctx = NULL;
+	line_buffer input;
+	std::string line;
+	std::string output;
+	size_t written = 0;
+	evloop_line_callback on_line;
+	evloop_close_callback on_close;
+	uint32_t events = 0;
+
+	// libtls asked for TLS_WANT_POLLOUT, so wait for the socket to be writable even with nothing queued
+	bool tls_wants_write = false;
+
+	// tls_write() asked for TLS_WANT_POLLIN, so the queued output waits for the socket to be readable.
+	// a writable socket would only wake the loop for another tls_write() that can't get anywhere.
+	bool tls_write_wants_read = false;
+
+	// set by evloop_remove() and when the connection ended, the callbacks may do either
+	bool removed = false;
+};
+
+struct evloop_state
+{
+	std::map<int, std::shared_ptr<evloop_connection>> connections;
+
+	// sockets with input epoll will not report: lines read_line() had already buffered when they arrived,
+	// or what is left after they used up EVLOOP_READ_BUDGET
+	std::vector<int> buffered;
+	size_t max_pending = EVLOOP_MAX_PENDING;
+	bool stopped = false;
+};
+
+// events returned by one epoll_wait()
+const int EVLOOP_EVENTS = 256;
+
+// bytes of lines one socket may hand to on_line per round, so a peer that never stops sending
+// can't keep the loop from the other sockets
+const size_t EVLOOP_READ_BUDGET = LINE_CHUNK;
+
+void _fd_reset(int fd)
+{
+	fd_state *slot = _fd(fd, false);
+	if(slot == NULL)
+	{
+		return;
+	}
+	struct tls *tlsctx = slot->tlsctx.exchange(NULL, std::memory_order_acq_rel);
+	if(tlsctx != NULL)
+	{
+		tls_free(tlsctx);
+	}
+	delete slot->lines.exchange(NULL, std::memory_order_acq_rel);
+	delete slot->evloop.exchange(NULL, std::memory_order_acq_rel);
+}
+
+// the state of an event loop from evloop_create(), NULL for any other fd
+evloop_state *_evloop_state(int loop)
+{
+	fd_state *slot = _fd(loop, false);
+	return slot == NULL ? NULL : slot->evloop.load(std::memory_order_acquire);
+}
+
+std::shared_ptr<evloop_connection> _evloop_find(int loop, int sock)
+{
+	evloop_state *state = _evloop_state(loop);
+	if(state == NULL)
+	{
+		return NULL;
+	}
+	std::map<int, std::shared_ptr<evloop_connection>>::iterator conn = state->connections.find(sock);
+	if(conn == state->connections.end())
+	{
+		return NULL;
+	}
+	return conn->second;
+}
+
+void _set_blocking(int sock, bool blocking)
+{
+	int flags = fcntl(sock, F_GETFL);
+	fcntl(sock, F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK);
+}
+
+// ask epoll for writability only while there is something to write
+void _evloop_watch(int loop, int sock, evloop_connection &conn)
+{
+	uint32_t events = EPOLLIN;
+	if((conn.written < conn.output.size() && conn.tls_write_wants_read == false) || conn.tls_wants_write == true)
+	{
+		events |= EPOLLOUT;
+	}
+	if(events != conn.events)
+	{
+		struct epoll_event ev;
+		ev.events = events;
+		ev.data.fd = sock;
+		if(epoll_ctl(loop, EPOLL_CTL_MOD, sock, &ev) == 0)
+		{
+			conn.events = events;
+		}
+	}
+}
+
+// write as much of the queued output as the socket takes without blocking
+// returns false when the connection failed
+bool _evloop_flush(int sock, evloop_connection &conn)
+{
+	while(conn.written < conn.output.size())
+	{
+		const char *data = conn.output.data() + conn.written;
+		size_t length = conn.output.size() - conn.written;
+		ssize_t n;
+		if(conn.tlsctx != NULL)
+		{
+			n = tls_write(conn.tlsctx, data, length);
+			if(n == TLS_WANT_POLLIN || n == TLS_WANT_POLLOUT)
+			{
+				conn.tls_wants_write = conn.tls_wants_write || n == TLS_WANT_POLLOUT;
+				conn.tls_write_wants_read = n == TLS_WANT_POLLIN;
+				break;
+			}
+			conn.tls_write_wants_read = false;
+		}
+		else
+		{
+			// a peer that went away must not kill the whole loop with SIGPIPE
+			n = send(sock, data, length, MSG_NOSIGNAL);
+			if(n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			{
+				break;
+			}
+		}
+		if(n <= 0)
+		{
+			return false;
+		}
+		conn.written += n;
+	}
+
+	if(conn.written == conn.output.size())
+	{
+		conn.output.clear();
+		conn.written = 0;
+	}
+	else if(conn.written > LINE_CHUNK && conn.written > conn.output.size() / 2)
+	{
+		conn.output.erase(0, conn.written);
+		conn.written = 0;
+	}
+	return true;
+}
+
+// hand the complete lines the socket has to on_line, up to EVLOOP_READ_BUDGET bytes of them.
+// more is set when the budget ran out before the socket did.
+// returns false when the peer closed the connection or it failed
+bool _evloop_read(int sock, const std::shared_ptr<evloop_connection> &conn, bool &more)
+{
+	bool would_block = false;
+	auto fill = [&](char *data, size_t size)
+	{
+		ssize_t n;
+		if(conn->tlsctx != NULL)
+		{
+			n = tls_read(conn->tlsctx, data, size);
+			if(n == TLS_WANT_POLLIN || n == TLS_WANT_POLLOUT)
+			{
+				conn->tls_wants_write = conn->tls_wants_write || n == TLS_WANT_POLLOUT;
+				would_block = true;
+				return (ssize_t)-1;
+			}
+			return n;
+		}
+		while((n = read(sock, data, size)) < 0 && errno == EINTR)
+		{
+		}
+		would_block = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+		return n;
+	};
+
+	size_t budget = EVLOOP_READ_BUDGET;
+	while(true)
+	{
+		int status = _read_line(conn->input, conn->line, LINE_MAX_LENGTH, fill);
+		if(status == LINE_EOF || (status == LINE_ERROR && would_block == false))
+		{
+			return false;
+		}
+		if(status == LINE_ERROR)
+		{
+			return true;
+		}
+		// a line longer than LINE_MAX_LENGTH arrives in pieces of that size
+		if(conn->on_line)
+		{
+			conn->on_line(sock, conn->line);
+		}
+		if(conn->removed == true)
+		{
+			return true;
+		}
+		// count the line ending too, so empty lines use up the budget as well
+		if(conn->line.size() + 1 >= budget)
+		{
+			more = true;
+			return true;
+		}
+		budget = budget - conn->line.size() - 1;
+	}
+}
 
-// explode implementation helper. we don't want people caling this, thus the anonymous namespace.
-// given a search delimited string subject, return the segment requested.
-// eg:  _explode_segment("||", "this||is||a||string", result, 2) // result == "a"
-// if segment was found return true, if segment was not found return false
-bool _explode_segment(const std::string &search, const std::string &subject, std::string &result, size_t segment = 0)
+// stop watching a socket whose connection ended and tell its owner
+void _evloop_end(int loop, int sock, const std::shared_ptr<evloop_connection> &conn)
 {
-	//std::string result;
-	std::string looptest;
-	size_t found_segment;
-
-	// segment 0 is a special case because we won't find search immediately before it.
-	// instead, just return from the start of string until we encounter search, not including search itself.
-	if(segment == 0)
+	epoll_ctl(loop, EPOLL_CTL_DEL, sock, NULL);
+	_evloop_state(loop)->connections.erase(sock);
+	conn->removed = true;
+	if(conn->on_close)
 	{
-		found_segment = subject.find(search, 0);
-		result = subject.substr(0, found_segment);
-		//std::cout << "found segment: 0 " << " result: " << result << std::endl;
-		// we have a good result
-		return true;
+		conn->on_close(sock);
 	}
+}
 
-	found_segment = 0;
-	result = "";
+void _evloop_dispatch(int loop, int sock, uint32_t events)
+{
+	// holding the connection keeps it alive while its callbacks remove it
+	std::shared_ptr<evloop_connection> conn = _evloop_find(loop, sock);
+	if(conn == NULL)
+	{
+		return;
+	}
 
-	// loop until we find the segment we want
-	for(size_t i = 0; i < subject.size(); i++)
+	// tls may need the socket readable to write or writable to read, so a tls socket retries both
+	conn->tls_wants_write = false;
+	conn->tls_write_wants_read = false;
+	bool alive = true;
+	bool more = false;
+	if((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0 || conn->tlsctx != NULL)
 	{
-		// have we found a segment?
-		if(subject.substr(i, search.size()) == search)
-		{
-			found_segment++;
-			result = subject.substr(i + search.size(), std::string::npos);
-			//std::cout << "found segment: [" << result << "] | ";
-			result = result.substr(0, result.find(search, 0));
-			//std::cout << "found segment: [" << result << "]" << std::endl;
-			if(found_segment == segment)
-			{
-				// we have a good result.
-				return true;
-			}
-			i = i + search.size() - 1;
-		}
+		alive = _evloop_read(sock, conn, more);
 	}
-	// we didn't find any segments. signal to caller that result is garbage.
-	return false;
+	if(conn->removed == true)
+	{
+		return;
+	}
+	if(more == true)
+	{
+		// the rest waits for the next round, after every other socket had its turn
+		_evloop_state(loop)->buffered.push_back(sock);
+	}
+	if(alive == true)
+	{
+		alive = _evloop_flush(sock, *conn);
+	}
+	if(alive == false)
+	{
+		_evloop_end(loop, sock, conn);
+		return;
+	}
+	_evloop_watch(loop, sock, *conn);
 }
 
-} //end anonymous namespace
+}
 
-// This does not handle limit like php's explode() does.
-// 1) Negative limit is undefined behavior.
-// 2) If limit is set and positive, the returned array will contain a maximum of limit elements. The last element will NOT contain the rest of string.
-std::vector<std::string> explode(std::string const &search, std::string const &subject, int limit /* = INT_MAX */)
+// create an event loop. max_pending caps the bytes queued per socket by evloop_write_line().
+// returns the event loop fd, or -1 on failure
+int evloop_create(size_t max_pending)
 {
-	std::vector<std::string> result_v;
-	std::string result;
-	int loop = 0;
-	bool found = false;
-	if(limit == 0)
+	int loop = epoll_create1(EPOLL_CLOEXEC);
+	if(loop < 0)
 	{
-		// PHP: if the limit parameter is zero, then this is treated as 1.
-		limit = 1;
+		std::cerr << "epoll_create1() failed!" << std::endl;
+		return -1;
 	}
-	while(1)
+	fd_state *slot = _fd(loop, true);
+	if(slot == NULL)
 	{
-		found = _explode_segment(search, subject, result, loop);
-		if(found == false || limit == loop)
-		{
-			// no more segments to get
-			break;
-		}
-		result_v.push_back(result);
-		loop++;
+		std::cerr << "event loop fd out of range." << std::endl;
+		close(loop);
+		return -1;
 	}
-	return result_v;
+	_fd_reset(loop);
+	evloop_state *state = new evloop_state();
+	state->max_pending = max_pending;
+	slot->evloop.store(state, std::memory_order_release);
+	return loop;
 }
 
-std::vector<std::string> str_split(const std::string &str, size_t length /* = 1 */)
+// watch a socket from sopen() or ssl_sopen(). on_line gets every line it receives, without the \r\n.
+// when the peer closes the connection or it fails the socket is removed and on_close is called,
+// the socket itself stays open for on_close to close(), or ssl_close() for a socket from ssl_sopen().
+// the socket is non-blocking while it is watched. returns true on success, false on failure
+bool evloop_add(int loop, int sock, evloop_line_callback on_line, evloop_close_callback on_close)
 {
-	std::vector<std::string> result_v;
-	std::string result;
-	size_t loop;
-
-	if(length > str.size())
+	evloop_state *state = _evloop_state(loop);
+	if(state == NULL || state->connections.count(sock) != 0)
 	{
-		length = str.size();
+		return false;
 	}
 
-	loop = 0;
-	while(loop < str.size())
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.fd = sock;
+	if(epoll_ctl(loop, EPOLL_CTL_ADD, sock, &ev) != 0)
 	{
-		result = str.substr(loop, length);
-		result_v.push_back(result);
-		loop = loop + length;
+		std::cerr << "epoll_ctl() failed!" << std::endl;
+		return false;
 	}
+	_set_blocking(sock, false);
 
-	return result_v;
-}
+	std::shared_ptr<evloop_connection> conn = std::make_shared<evloop_connection>();
+	conn->events = EPOLLIN;
+	conn->on_line = on_line;
+	conn->on_close = on_close;
+	conn->tlsctx = _fd_tls(sock);
 
-std::string implode(const std::string &separator, const std::vector<std::string> &array)
-{
-	std::string result;
-	for(size_t i = 0; i < array.size(); i++)
+	// carry over what read_line() or ssl_read_line() had already read from the socket
+	fd_state *slot = _fd(sock, false);
+	line_buffer *lines = slot == NULL ? NULL : slot->lines.load(std::memory_order_acquire);
+	if(lines != NULL)
 	{
-		result.append(array[i]);
-		if(i < array.size() - 1)
+		conn->input = std::move(*lines);
+		_fd_drop_lines(sock);
+		if(conn->input.start != conn->input.end)
 		{
-			// this prevents a tailing seperator going on the end during the last loop cycle
-			result.append(separator);
+			state->buffered.push_back(sock);
 		}
 	}
-	return result;
+	state->connections[sock] = conn;
+	return true;
 }
 
-/*********************
- * Network functions *
- *********************
-*/
-
-// performs a dns lookup on input and returns an IP address
-// returns input unmodified on failure.
-std::string __gethostbyname(const std::string &input)
+// queue line followed by \r\n for sock and write as much of it as the socket takes right away.
+// returns true on success, false when the socket is not watched, its queue is full (see evloop_create())
+// or the connection failed
+bool evloop_write_line(int loop, int sock, const std::string &line)
 {
-	struct hostent *h = gethostbyname(input.c_str());
-	struct in_addr a;
-	if(h == NULL)
+	std::shared_ptr<evloop_connection> conn = _evloop_find(loop, sock);
+	if(conn == NULL || conn->output.size() - conn->written + line.size() + 2 > _evloop_state(loop)->max_pending)
 	{
-		//herror("gethostbyname");
-		return input;
+		return false;
 	}
-	if(h->h_addrtype == AF_INET)
+	conn->output.append(line).append("\r\n", 2);
+	if(_evloop_flush(sock, *conn) == false)
 	{
-		//printf("name: %s\n", h->h_name);
-		//while(*h->h_aliases) printf("alias: %s\n", *h->h_aliases++);
-		while(*h->h_addr_list)
-		{
-			memmove((char *) &a, *h->h_addr_list++, sizeof(a));
-			//printf("address: %s\n", inet_ntoa(a));
-			return inet_ntoa(a);
-		}
+		return false;
 	}
-	return input;
+	_evloop_watch(loop, sock, *conn);
+	return true;
 }
 
-// similar to file_get_contents, but for the network
-// returns empty string on failure
-std::string url_get_contents(const std::string &input)
+// returns the bytes queued for sock that were not written yet
+size_t evloop_pending(int loop, int sock)
 {
-	if(input.substr(0, 7) == "http://" || input.substr(0, 8) == "https://")
+	std::shared_ptr<evloop_connection> conn = _evloop_find(loop, sock);
+	if(conn == NULL)
 	{
-		http fetch = http_fetch(input);
-
-		if(fetch.status != 200)
-		{
-			return "";
-		}
-		return fetch.body;
+		return 0;
 	}
-	return "";
+	return conn->output.size() - conn->written;
 }
 
-// open tcp socket connection to hostname on port
-// returns a socket fd, or -1 on failure
-int sopen(const std::string &hostname, int port)
+// stop watching sock without closing it. the socket is blocking again, lines it buffered are
+// left for read_line() and output that was not written yet is dropped.
+// returns true on success, false when sock was not watched
+bool evloop_remove(int loop, int sock)
 {
-	int sock;
-	struct sockaddr_in serv_addr;
-	struct timeval timeout;
-	sock = 0;
-
-	std::string host = __gethostbyname(hostname);
-	if(host == "")
+	std::shared_ptr<evloop_connection> conn = _evloop_find(loop, sock);
+	if(conn == NULL)
 	{
-		std::cerr << "hostname lookup failure!" << std::endl;
-		return -1;
+		return false;
 	}
-	//std::cerr << "gethostbyname: " << host << std::endl;
-
-	sock = socket(AF_INET, SOCK_STREAM, 0);
-	if(sock < 0)
+	epoll_ctl(loop, EPOLL_CTL_DEL, sock, NULL);
+	_evloop_state(loop)->connections.erase(sock);
+	conn->removed = true;
+	if(conn->input.start != conn->input.end)
 	{
-		std::cerr << "socket creation failed!" << std::endl;
-		return -1;
+		*_fd_lines(sock) = std::move(conn->input);
 	}
+	_set_blocking(sock, true);
+	return true;
+}
 
-	// timeout after 10 minutes
-	timeout.tv_sec = 600;
-	timeout.tv_usec = 0;
-
-	if(setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0
-	|| setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0)
+// wait up to timeout milliseconds (-1 for ever) for socket events and handle them
+// returns the number of sockets handled, or -1 on failure
+int evloop_run_once(int loop, int timeout)
+{
+	evloop_state *state = _evloop_state(loop);
+	if(state == NULL)
 	{
-		std::cerr << "setsockopt failed!" << std::endl;
+		return -1;
 	}
+	std::vector<int> buffered;
+	buffered.swap(state->buffered);
 
-	serv_addr.sin_family = AF_INET;
-	serv_addr.sin_port = htons(port);
-
-	// Convert IPv4 and IPv6 addresses from text to binary form
-	if(inet_pton(AF_INET, host.c_str(), &serv_addr.sin_addr) <= 0)
+	struct epoll_event events[EVLOOP_EVENTS];
+	int count = epoll_wait(loop, events, EVLOOP_EVENTS, buffered.empty() ? timeout : 0);
+	if(count < 0 && errno != EINTR)
 	{
-		std::cerr << "invalid address!" << std::endl;
+		std::cerr << "epoll_wait() failed!" << std::endl;
 		return -1;
 	}
+	count = std::max(count, 0);
 
-	if(connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+	for(int sock : buffered)
 	{
-		std::cerr << "connection failed!" << std::endl;
-		return -1;
+		_evloop_dispatch(loop, sock, EPOLLIN);
 	}
-	return sock;
+	for(int i = 0; i < count; i++)
+	{
+		_evloop_dispatch(loop, events[i].data.fd, events[i].events);
+	}
+	return count + buffered.size();
 }
 
-// read a line from socket and return it.
-std::string read_line(int sock)
+// handle socket events until evloop_stop() is called or no socket is left
+// returns true on success, false on failure
+bool evloop_run(int loop)
 {
-	char tmp[1];
-	char buf[8192];
-
-	for(int i = 0; i < 8192; i++)
+	evloop_state *state = _evloop_state(loop);
+	if(state == NULL)
+	{
+		return false;
+	}
+	state->stopped = false;
+	while(true)
 	{
-		if(read(sock, tmp, 1) != 1)
+		// callbacks may destroy the loop
+		state = _evloop_state(loop);
+		if(state == NULL || state->stopped == true || state->connections.empty())
 		{
-			std::cerr << "socket failure. read failed." << std::endl;
-			return "";
+			return true;
 		}
-		buf[i] = tmp[0];
-		if(tmp[0] == '\n' || tmp[0] == '\r')
+		if(evloop_run_once(loop, -1) < 0)
 		{
-			// do not break if the first byte we read is a newline character.
-			// this prevents returning an empty string for no good reason.
-			if(i > 0)
-			{
-				buf[i] = '\0';
-				break;
-			}
+			return false;
 		}
 	}
-	std::string result = buf;
-	return trim(result);
 }
 
-// returns true on success, false on failure
-bool write_line(int sock, const std::string &line)
+// make evloop_run() return after the events it is handling, callbacks can call this
+void evloop_stop(int loop)
 {
-	if(write(sock, line.c_str(), line.length()) != (ssize_t)line.length())
-	{
-		std::cerr << "socket failure. write failed." << std::endl;
-		return false;
-	}
-	if(write(sock, "\r\n", 2) != 2)
+	evloop_state *state = _evloop_state(loop);
+	if(state != NULL)
 	{
-		std::cerr << "socket failure. write failed." << std::endl;
-		return false;
+		state->stopped = true;
 	}
-	return true;
 }
 
-// close socket
-void __close(int sock)
+// evloop_remove() every socket and close the event loop
+void evloop_destroy(int loop)
 {
-	close(sock);
+	evloop_state *state = _evloop_state(loop);
+	if(state == NULL)
+	{
+		return;
+	}
+	std::vector<int> socks;
+	for(const auto &conn : state->connections)
+	{
+		socks.push_back(conn.first);
+	}
+	for(int sock : socks)
+	{
+		evloop_remove(loop, sock);
+	}
+	delete _fd(loop, false)->evloop.exchange(NULL, std::memory_order_acq_rel);
+	close(loop);
 }
 
-/*****************
- * TLS functions *
- *****************
+/*****************************
+ * connection pool functions *
+ *****************************
 */
 
-// this keeps a mapping of tls sockets to the tls session state
-// which allows the external api for this to be the same as for the non-ssl function versions
-// this also properly handles having multiple ssl sockets open at the same time
+namespace
+{
 
-// pack the tls structs into a common struct
-struct sslstruct {
-	struct tls_config *tlscfg = NULL;
-	struct tls *tlsctx = NULL;
+// what a pooled connection was opened to, connections are only reused for the same key
+typedef std::tuple<std::string, int, bool, bool> pool_key;
+
+struct pool_idle
+{
+	int sock;
+	long long since;
+};
+
+// the connections of one key, open counts the idle ones and the ones handed out
+struct pool_host
+{
+	std::vector<pool_idle> idle;
+	size_t open = 0;
 };
 
-// create a mapping between the tls sockets and our common ssl struct
-std::map<int, struct sslstruct> sslmap;
+// the pool is shared by every thread, so it is only touched with pool_mutex held
+std::mutex pool_mutex;
+std::map<pool_key, pool_host> pools;
+std::map<int, pool_key> pool_socks;
+size_t pool_max_per_host = 16;
+int pool_idle_timeout = 30000;
 
-// open a tls connection to hostname on port
-// set verify false to disable all tls validation and certificate checking
-// returns true on success or false on failure
-int ssl_sopen(const std::string &hostname, int port, bool verify)
+// close a pooled socket the way it was opened
+void _pool_close(int sock, bool tls)
 {
-	int tlssock = sopen(hostname, port);
-	if(tlssock == -1)
+	if(tls == true)
 	{
-		std::cerr << "error opening socket for ssl." << std::endl;
-		return -1;
+		ssl_close(sock);
 	}
-	struct sslstruct ssl;
-	ssl.tlscfg = NULL;
-	ssl.tlsctx = NULL;
-	if(tls_init() != 0)
+	else
 	{
-		std::cerr << "tls_init() failed!" << std::endl;
-		return -1;
+		__close(sock);
 	}
-	if((ssl.tlscfg = tls_config_new()) == NULL)
+}
+
+// an idle connection is usable when the peer neither closed it nor sent anything unasked,
+// checked with a peek that does not block and does not consume
+bool _pool_alive(int sock)
+{
+	if(_fd_has_lines(sock) == true)
 	{
-		std::cerr << "tls_config_new() failed!" << std::endl;
-		return -1;
+		return false;
 	}
-	if((ssl.tlsctx = tls_client()) == NULL)
+	char byte;
+	ssize_t n = recv(sock, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+	return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+// move the idle connections of host that timed out into doomed, pool_mutex must be held
+void _pool_expire(pool_host &host, long long now, std::vector<int> &doomed)
+{
+	for(size_t i = 0; i < host.idle.size(); )
 	{
-		std::cerr << "tls_client() failed!" << std::endl;
-		return -1;
+		if(now - host.idle[i].since >= pool_idle_timeout)
+		{
+			doomed.push_back(host.idle[i].sock);
+			host.idle.erase(host.idle.begin() + i);
+		}
+		else
+		{
+			i++;
+		}
 	}
-	if(tls_configure(ssl.tlsctx, ssl.tlscfg) != 0)
+}
+
+// forget doomed sockets and close them, pool_mutex must not be held
+void _pool_close_all(const std::vector<int> &doomed, bool tls)
+{
+	for(int sock : doomed)
 	{
-		std::cerr << "tls_configure(): " << tls_error(ssl.tlsctx) << std::endl;
-		return -1;
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			std::map<int, pool_key>::iterator pooled = pool_socks.find(sock);
+			if(pooled != pool_socks.end())
+			{
+				pools[pooled->second].open--;
+				pool_socks.erase(pooled);
+			}
+		}
+		_pool_close(sock, tls);
 	}
-	if(verify == false)
-	{
-		// disable certificate & oscp validation
-		tls_config_insecure_noverifycert(ssl.tlscfg);
+}
 
-		// disable server name validation
-		tls_config_insecure_noverifyname(ssl.tlscfg);
+}
 
-		// disable checking certificate expiration
-		tls_config_insecure_noverifytime(ssl.tlscfg);
+// get a connection to hostname on port from the pool, opening one with sopen() or ssl_sopen() (tls)
+// when no idle connection to the same host, port, tls and verify is left. give it back with pool_release(),
+// or pool_close() it when it is no longer usable.
+// returns a socket fd, or -1 on failure or when max_per_host connections are already open (see pool_set_limits())
+int pool_sopen(const std::string &hostname, int port, bool tls, bool verify)
+{
+	pool_key key(hostname, port, tls, verify);
+	std::vector<int> doomed;
+	int sock = -1;
+	bool full = false;
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		pool_host &host = pools[key];
+		_pool_expire(host, _now_ms(), doomed);
+
+		// the most recently released connection is the least likely to have been dropped
+		while(sock == -1 && host.idle.empty() == false)
+		{
+			int candidate = host.idle.back().sock;
+			host.idle.pop_back();
+			if(_pool_alive(candidate) == true)
+			{
+				sock = candidate;
+			}
+			else
+			{
+				doomed.push_back(candidate);
+			}
+		}
+		if(sock == -1)
+		{
+			// count the new connection now so other threads see the limit while it connects
+			full = host.open - doomed.size() >= pool_max_per_host;
+			if(full == false)
+			{
+				host.open++;
+			}
+		}
+	}
+	_pool_close_all(doomed, tls);
+	if(sock != -1)
+	{
+		return sock;
 	}
-	// if(tls_connect(tlsctx, hostname.c_str(), std::to_string(port).c_str()) != 0)
-	if(tls_connect_socket(ssl.tlsctx, tlssock, hostname.c_str()) != 0)
+	if(full == true)
 	{
-		std::cerr << "tls_connect(): " << tls_error(ssl.tlsctx) << std::endl;
+		std::cerr << "connection pool limit reached!" << std::endl;
 		return -1;
 	}
-	if(tls_handshake(ssl.tlsctx) != 0)
+
+	sock = tls ? ssl_sopen(hostname, port, verify) : sopen(hostname, port);
+
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	if(sock == -1)
 	{
-		std::cerr << "tls_handshake(): " << tls_error(ssl.tlsctx) << std::endl;
+		pools[key].open--;
 		return -1;
 	}
-	sslmap[tlssock] = ssl;
-	return tlssock;
+	pool_socks[sock] = key;
+	return sock;
 }
 
-// read a line from tls socket and return it.
-std::string ssl_read_line(int tlssock)
+// give a connection from pool_sopen() back for reuse. the request/response on it must be complete.
+// returns true on success, false when sock did not come from pool_sopen()
+bool pool_release(int sock)
 {
-	char tmp[1];
-	char buf[8192];
-	ssize_t state;
-	int i = 0;
-
-	struct sslstruct ssl;
-	ssl = sslmap[tlssock];
-
-	while(i < 8192)
+	std::vector<int> doomed;
+	bool tls = false;
 	{
-		state = tls_read(ssl.tlsctx, tmp, 1);
-		if(state == -1)
-		{
-			std::cerr << "socket failure. read failed." << std::endl;
-			exit(EXIT_FAILURE);
-		}
-		if(state == TLS_WANT_POLLIN)
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		std::map<int, pool_key>::iterator pooled = pool_socks.find(sock);
+		if(pooled == pool_socks.end())
 		{
-			usleep(100000);
-			continue;
+			return false;
 		}
-		if(state != 1)
+		tls = std::get<2>(pooled->second);
+		pool_host &host = pools[pooled->second];
+		long long now = _now_ms();
+		_pool_expire(host, now, doomed);
+
+		// unread lines mean the exchange on it was not finished, so it can not be reused
+		if(pool_idle_timeout <= 0 || _fd_has_lines(sock) == true)
 		{
-			std::cerr << "tls_read() failure." << std::endl;
-			exit(EXIT_FAILURE);
+			doomed.push_back(sock);
 		}
-
-		buf[i] = tmp[0];
-		if(tmp[0] == '\n' || tmp[0] == '\r')
+		else
 		{
-			// do not break if the first byte we read is a newline character.
-			// this prevents returning an empty string for no good reason.
-			if(i > 0)
-			{
-				buf[i] = '\0';
-				break;
-			}
+			pool_idle idle;
+			idle.sock = sock;
+			idle.since = now;
+			host.idle.push_back(idle);
 		}
-		i++;
 	}
-	std::string result = buf;
-	return trim(result);
+	_pool_close_all(doomed, tls);
+	return true;
 }
 
-// returns true on success, false on failure
-bool ssl_write_line(int tlssock, const std::string &line)
+// close a connection from pool_sopen() and free its place in the pool
+// returns true on success, false when sock did not come from pool_sopen()
+bool pool_close(int sock)
 {
-	struct sslstruct ssl;
-	ssl = sslmap[tlssock];
-
-	if(tls_write(ssl.tlsctx, line.c_str(), line.length()) != (ssize_t)line.length())
+	bool tls = false;
 	{
-		std::cerr << "ssl socket failure. write failed." << std::endl;
-		return false;
-	}
-	if(tls_write(ssl.tlsctx, "\r\n", 2) != 2)
-	{
-		std::cerr << "ssl socket failure. write failed." << std::endl;
-		return false;
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		std::map<int, pool_key>::iterator pooled = pool_socks.find(sock);
+		if(pooled == pool_socks.end())
+		{
+			return false;
+		}
+		tls = std::get<2>(pooled->second);
 	}
+	_pool_close_all(std::vector<int>(1, sock), tls);
 	return true;
 }
 
-void ssl_close(int tlssock)
+// at most max_per_host connections per host, port, tls and verify, and idle ones are closed
+// after idle_timeout milliseconds (0 closes them on release). the defaults are 16 and 30 seconds
+void pool_set_limits(size_t max_per_host, int idle_timeout)
 {
-	struct sslstruct ssl;
-	ssl = sslmap[tlssock];
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	pool_max_per_host = max_per_host;
+	pool_idle_timeout = idle_timeout;
+}
 
-	if(tls_close(ssl.tlsctx) != 0)
+// close every idle connection in the pool
+void pool_flush()
+{
+	std::vector<int> plain;
+	std::vector<int> tls;
 	{
-		std::cerr << "tls_close(): " << tls_error(ssl.tlsctx) << std::endl;
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		for(auto &host : pools)
+		{
+			for(const pool_idle &idle : host.second.idle)
+			{
+				(std::get<2>(host.first) ? tls : plain).push_back(idle.sock);
+			}
+			host.second.idle.clear();
+		}
 	}
-	tls_free(ssl.tlsctx);
-	tls_config_free(ssl.tlscfg);
-	sslmap.erase(tlssock);
-	close(tlssock);
+	_pool_close_all(plain, false);
+	_pool_close_all(tls, true);
 }
 
 /************************
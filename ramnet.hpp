@@ -24,7 +24,16 @@
 
 #include <string>
 #include <climits>
+#include <cstring>
 #include <vector>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 namespace ramnet {
 
@@ -36,47 +45,333 @@ const size_t STR_PAD_LEFT = 2;
 const size_t STR_PAD_BOTH = 3;
 const size_t FILE_APPEND = 8;
 
+// base64_decode_into() results
+const int BASE64_OK = 0;
+const int BASE64_INVALID = 1;
+const int BASE64_TOO_SMALL = 2;
+
+// read_line() results, and the longest line it returns by default
+const int LINE_OK = 0;
+const int LINE_EOF = 1;
+const int LINE_TOO_LONG = 2;
+const int LINE_ERROR = 3;
+const size_t LINE_MAX_LENGTH = 1048576;
+
+// the bytes an event loop queues per socket by default, see evloop_create()
+const size_t EVLOOP_MAX_PENDING = 1048576;
+
+// the pending connection queue slisten() asks for by default, the kernel caps it at its own limit
+const int LISTEN_BACKLOG = 4096;
+
+// a compiled set of strings for strtr(), see strtr_compile()
+// build it once and reuse it to run the same translation over many strings.
+struct strtr_table
+{
+	std::vector<std::string> to;
+	std::vector<size_t> length; // length of each from string
+	std::vector<int> next; // dfa transitions over the reversed from strings, 256 per state
+	std::vector<int> match; // from index of the longest from string each state ends with, or -1
+	size_t longest = 0; // length of the longest from string
+	bool grows = false; // true if any to string is longer than its from string
+};
+
+// a needle prepared for searching many haystacks, see str_needle_compile()
+// constructing one compiles it, the fields are set up by the constructor and read by the search.
+struct str_needle
+{
+	std::string needle;
+	size_t suffix = 0; // two-way critical factorization, only used for long needles
+	size_t period = 0;
+	bool periodic = false;
+
+	str_needle(const std::string &needle = std::string());
+};
+
+// one argument to str_format(), whatever type it was passed as.
+// used by the templates below, not meant to be used directly.
+namespace detail
+{
+
+struct format_arg
+{
+	char type; // 'i' signed, 'u' unsigned, 'd' double, 's' string
+	long long i = 0;
+	unsigned long long u = 0;
+	double d = 0;
+	const char *s = NULL;
+	size_t len = 0;
+
+	format_arg(bool v) : type('i'), i(v) {}
+	format_arg(char v) : type('i'), i(v) {}
+	format_arg(signed char v) : type('i'), i(v) {}
+	format_arg(short v) : type('i'), i(v) {}
+	format_arg(int v) : type('i'), i(v) {}
+	format_arg(long v) : type('i'), i(v) {}
+	format_arg(long long v) : type('i'), i(v) {}
+	format_arg(unsigned char v) : type('u'), u(v) {}
+	format_arg(unsigned short v) : type('u'), u(v) {}
+	format_arg(unsigned int v) : type('u'), u(v) {}
+	format_arg(unsigned long v) : type('u'), u(v) {}
+	format_arg(unsigned long long v) : type('u'), u(v) {}
+	format_arg(float v) : type('d'), d(v) {}
+	format_arg(double v) : type('d'), d(v) {}
+	format_arg(const char *v) : type('s'), s(v), len(strlen(v)) {}
+	format_arg(const std::string &v) : type('s'), s(v.data()), len(v.size()) {}
+#if __cplusplus >= 201703L
+	format_arg(std::string_view v) : type('s'), s(v.data()), len(v.size()) {}
+#endif
+};
+
+}
+
+// the state of one streaming base64 encoding or decoding, see base64_stream_init()
+// it holds the bytes of a group that has only partly arrived between calls.
+struct base64_stream
+{
+	unsigned char carry[4];
+	size_t carried = 0;
+	bool url = false; // encode with the url safe alphabet
+	bool failed = false; // the decoder saw something that isn't base64
+};
+
 // math functions
 int rand(const int min = 0, const int max = RAND_MAX);
+void mt_srand(unsigned long long seed);
+int random_int(int min, int max);
+std::vector<int> random_int(int min, int max, size_t count);
+std::string random_bytes(size_t length);
 bool is_int(const std::string &str);
+bool is_int(const std::string &str, long long &value);
+bool is_numeric(const std::string &str);
+bool is_numeric(const std::string &str, double &value);
+long long intval(const std::string &str, int base = 10);
+double floatval(const std::string &str);
 
 // string functions
+// the std::string&& overloads reuse the buffer of a temporary, so chained calls like strtolower(trim(x)) never reallocate.
+// the *_inplace versions modify str directly.
 std::string ltrim(const std::string &str, const std::string &whitespace = " \n\r\t\f\v");
+std::string ltrim(std::string &&str, const std::string &whitespace = " \n\r\t\f\v");
+void ltrim_inplace(std::string &str, const std::string &whitespace = " \n\r\t\f\v");
 std::string rtrim(const std::string &str, const std::string &whitespace = " \n\r\t\f\v");
+std::string rtrim(std::string &&str, const std::string &whitespace = " \n\r\t\f\v");
+void rtrim_inplace(std::string &str, const std::string &whitespace = " \n\r\t\f\v");
 std::string trim(const std::string &str, const std::string &whitespace = " \n\r\t\f\v");
+std::string trim(std::string &&str, const std::string &whitespace = " \n\r\t\f\v");
+void trim_inplace(std::string &str, const std::string &whitespace = " \n\r\t\f\v");
 bool str_contains(const std::string &haystack, const std::string &needle);
+bool str_contains(const std::string &haystack, const str_needle &needle);
+size_t strpos(const std::string &haystack, const std::string &needle, size_t offset = 0);
+size_t strpos(const std::string &haystack, const str_needle &needle, size_t offset = 0);
+size_t stripos(const std::string &haystack, const std::string &needle, size_t offset = 0);
+size_t strrpos(const std::string &haystack, const std::string &needle, size_t offset = 0);
+size_t substr_count(const std::string &haystack, const std::string &needle);
+size_t substr_count(const std::string &haystack, const str_needle &needle);
+str_needle str_needle_compile(const std::string &needle);
 std::string strrev(std::string str);
 std::string str_rot13(const std::string &str);
+std::string str_rot13(std::string &&str);
+void str_rot13_inplace(std::string &str);
 std::string str_repeat(const std::string &str, const size_t times);
 std::string str_pad(const std::string &input, size_t length, const std::string pad_str = " ", size_t pad_type = STR_PAD_RIGHT);
+std::string str_pad(std::string &&input, size_t length, const std::string pad_str = " ", size_t pad_type = STR_PAD_RIGHT);
+void str_pad_inplace(std::string &input, size_t length, const std::string &pad_str = " ", size_t pad_type = STR_PAD_RIGHT);
 std::string ucfirst(const std::string &str);
+std::string ucfirst(std::string &&str);
+void ucfirst_inplace(std::string &str);
 std::string lcfirst(const std::string &str);
+std::string lcfirst(std::string &&str);
+void lcfirst_inplace(std::string &str);
 std::string strtoupper(const std::string &str);
+std::string strtoupper(std::string &&str);
+void strtoupper_inplace(std::string &str);
 std::string strtolower(const std::string &str);
+std::string strtolower(std::string &&str);
+void strtolower_inplace(std::string &str);
 std::string str_replace(const std::string &search, const std::string &replace, const std::string &subject);
+std::string str_replace(const std::string &search, const std::string &replace, const std::string &subject, size_t &count);
+std::string str_replace(const std::vector<std::string> &search, const std::vector<std::string> &replace, const std::string &subject);
+std::string str_replace(const std::vector<std::string> &search, const std::vector<std::string> &replace, const std::string &subject, size_t &count);
+std::string strtr(const std::string &str, const std::vector<std::string> &from, const std::vector<std::string> &to);
+std::string strtr(const std::string &str, const std::vector<std::string> &from, const std::vector<std::string> &to, size_t &count);
+strtr_table strtr_compile(const std::vector<std::string> &from, const std::vector<std::string> &to);
+std::string strtr(const std::string &str, const strtr_table &table);
+std::string strtr(const std::string &str, const strtr_table &table, size_t &count);
+std::string bin2hex(const std::string &str);
+std::string hex2bin(const std::string &str);
+bool hex2bin(const std::string &str, std::string &out);
+std::string number_format(double num, int decimals = 0, const std::string &dec_point = ".", const std::string &thousands_sep = ",");
+void number_format_append(std::string &out, double num, int decimals = 0, const std::string &dec_point = ".", const std::string &thousands_sep = ",");
+namespace detail
+{
+void format_into(std::string &out, const std::string &format, const format_arg *args, size_t count); // use str_format() or str_format_append()
+}
+
+// php's sprintf(), named so it can't be mistaken for the C one under "using namespace ramnet".
+// str_format_append() writes onto the end of out instead of returning a new string,
+// so a buffer that is cleared and reused between calls stops allocating once it is big enough.
+template <typename... Args>
+void str_format_append(std::string &out, const std::string &format, const Args &... args)
+{
+	// the extra element keeps the array from being empty when there are no arguments
+	const detail::format_arg list[] = { detail::format_arg(args)..., detail::format_arg(0) };
+	detail::format_into(out, format, list, sizeof...(args));
+}
+
+template <typename... Args>
+std::string str_format(const std::string &format, const Args &... args)
+{
+	std::string result;
+	str_format_append(result, format, args...);
+	return result;
+}
 
 // array functions
 std::vector<std::string> explode(std::string const &search, std::string const &subject, int limit = INT_MAX);
+bool explode_next(const std::string &search, const std::string &subject, size_t &pos, size_t &seg_pos, size_t &seg_len);
 std::vector<std::string> str_split(const std::string &str, size_t length = 1);
 std::string implode(const std::string &separator, const std::vector<std::string> &array);
+namespace detail
+{
+// used by the templated implode()
+size_t implode_length(const format_arg &piece);
+void implode_append(std::string &out, const format_arg &piece);
+
+template <typename Range>
+struct range_value
+{
+	typedef typename std::decay<decltype(*std::begin(std::declval<const Range &>()))>::type type;
+};
+
+// presize the result of implode() when the range can be walked twice
+template <typename Range>
+void implode_reserve(std::string &result, const std::string &separator, const Range &array, std::forward_iterator_tag)
+{
+	size_t length = 0;
+	size_t count = 0;
+	for(const auto &piece : array)
+	{
+		length = length + implode_length(format_arg(piece));
+		count++;
+	}
+	if(count != 0)
+	{
+		result.reserve(length + separator.size() * (count - 1));
+	}
+}
+
+// a single pass range is appended as it comes
+template <typename Range>
+void implode_reserve(std::string &, const std::string &, const Range &, std::input_iterator_tag)
+{
+}
+}
+
+// implode() for any range (vector, list, array, ...) of strings, const char *, or numbers.
+// numbers are formatted straight into the result, so there is no temporary vector of strings.
+// ranges of char, such as a string literal, are not taken, those are a string and not a list of pieces.
+template <typename Range, typename = typename std::enable_if<std::is_same<typename detail::range_value<Range>::type, char>::value == false>::type>
+std::string implode(const std::string &separator, const Range &array)
+{
+	std::string result;
+	detail::implode_reserve(result, separator, array, typename std::iterator_traits<decltype(std::begin(array))>::iterator_category());
+
+	bool first = true;
+	for(const auto &piece : array)
+	{
+		if(first == false)
+		{
+			result.append(separator);
+		}
+		detail::implode_append(result, detail::format_arg(piece));
+		first = false;
+	}
+	return result;
+}
+void shuffle(std::vector<std::string> &array);
+std::vector<size_t> array_rand(const std::vector<std::string> &array, size_t num = 1);
 
 // network functions
 std::string __gethostbyname(const std::string &input);
+std::vector<std::string> resolve(const std::string &hostname);
+std::vector<std::vector<std::string>> resolve_batch(const std::vector<std::string> &hostnames, size_t threads = 8);
+void resolver_set_ttl(int ttl, int negative_ttl);
+void resolver_flush();
 std::string url_get_contents(const std::string &input);
 int sopen(const std::string &hostname, int port);
+int sopen(const std::string &hostname, int port, int connect_timeout, int timeout);
 std::string read_line(int sock);
+int read_line(int sock, std::string &line, size_t max_length = LINE_MAX_LENGTH);
 bool write_line(int sock, const std::string &line);
+bool write_lines(int sock, const std::vector<std::string> &lines);
+bool socket_set_nodelay(int sock, bool enable);
+bool socket_set_cork(int sock, bool enable);
+int socket_port(int sock);
+int slisten(int port, int backlog = LISTEN_BACKLOG);
+std::vector<int> slisten_reuseport(int port, size_t listeners, int backlog = LISTEN_BACKLOG);
+int saccept(int listener);
+int saccept(int listener, int timeout);
 void __close(int sock);
 
 // tls functions
 int ssl_sopen(const std::string &hostname, int port, bool verify);
+int ssl_sopen(const std::string &hostname, int port, bool verify, const std::string &ca_file);
+int ssl_sopen(const std::string &hostname, int port, bool verify, const std::string &ca_file, int connect_timeout, int timeout);
+bool ssl_session_resumed(int tlssock);
 std::string ssl_read_line(int tlssock);
+int ssl_read_line(int tlssock, std::string &line, size_t max_length = LINE_MAX_LENGTH);
 bool ssl_write_line(int tlssock, const std::string &line);
+bool ssl_write_lines(int tlssock, const std::vector<std::string> &lines);
 void ssl_close(int tlssock);
 
+// event loop functions
+typedef std::function<void(int sock, const std::string &line)> evloop_line_callback;
+typedef std::function<void(int sock)> evloop_close_callback;
+int evloop_create(size_t max_pending = EVLOOP_MAX_PENDING);
+bool evloop_add(int loop, int sock, evloop_line_callback on_line, evloop_close_callback on_close = NULL);
+bool evloop_write_line(int loop, int sock, const std::string &line);
+size_t evloop_pending(int loop, int sock);
+bool evloop_remove(int loop, int sock);
+int evloop_run_once(int loop, int timeout);
+bool evloop_run(int loop);
+void evloop_stop(int loop);
+void evloop_destroy(int loop);
+
+// connection pool functions
+int pool_sopen(const std::string &hostname, int port, bool tls = false, bool verify = true);
+bool pool_release(int sock);
+bool pool_close(int sock);
+void pool_set_limits(size_t max_per_host, int idle_timeout);
+void pool_flush();
+
 // base64 functions
 std::string __base64_decode(const std::string &str);
 std::string __base64_encode(const std::string &str);
+std::string base64_encode_url(const std::string &str);
+std::string base64_encode_pem(const std::string &str);
+std::string base64_encode_mime(const std::string &str);
+std::string base64_decode_mime(const std::string &str);
+size_t base64_decoded_size(const char *data, size_t length);
+size_t base64_decoded_size(const std::string &str);
+int base64_decode_into(const char *data, size_t length, char *out, size_t capacity, size_t &written, size_t &offset);
+int base64_decode_into(const std::string &str, std::string &out, size_t &offset);
+base64_stream base64_stream_init(bool url = false);
+void base64_encode_update(base64_stream &stream, const char *data, size_t length, std::string &out);
+void base64_encode_update(base64_stream &stream, const std::string &chunk, std::string &out);
+void base64_encode_final(base64_stream &stream, std::string &out);
+bool base64_decode_update(base64_stream &stream, const char *data, size_t length, std::string &out);
+bool base64_decode_update(base64_stream &stream, const std::string &chunk, std::string &out);
+bool base64_decode_final(base64_stream &stream, std::string &out);
+bool base64_encode_fd(int in_fd, int out_fd, bool url = false);
+bool base64_decode_fd(int in_fd, int out_fd);
+bool base64_encode_file(const std::string &source, const std::string &destination, bool url = false);
+bool base64_decode_file(const std::string &source, const std::string &destination);
+
+// url functions
+std::string urlencode(const std::string &str);
+std::string rawurlencode(const std::string &str);
+std::string urldecode(const std::string &str);
+std::string rawurldecode(const std::string &str);
 
 // process functions
 std::string shell_exec(const std::string &cmd, const std::string &input, int &status, int timeout);
@@ -1,9 +1,68 @@
 #include "ramnet.hpp"
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <thread>
+#include <tls.h>
 
 using namespace ramnet;
 
+// close fd the way code that doesn't know about ramnet would, without __close().
+// <unistd.h> would make the bare close() calls below ambiguous, fclose() of an fdopen() stream closes fd too.
+void plain_close(int fd)
+{
+	fclose(fdopen(fd, "r"));
+}
+
+// true when implode() takes a range of type T
+template <typename T>
+auto implodable(int) -> decltype(implode(",", std::declval<const T &>()), true)
+{
+	return true;
+}
+
+template <typename T>
+bool implodable(...)
+{
+	return false;
+}
+
+// PHP's strtr() with an array of pairs, done the plain way to check strtr() against:
+// at each position the longest from string wins, of equal ones the last as array_combine() would keep it.
+std::string strtr_reference(const std::string &str, const std::vector<std::string> &from, const std::vector<std::string> &to)
+{
+	std::string result;
+	size_t i = 0;
+	while(i < str.size())
+	{
+		int best = -1;
+		for(size_t j = 0; j < from.size(); j++)
+		{
+			if(from[j].empty() == false && str.compare(i, from[j].size(), from[j]) == 0 && (best == -1 || from[j].size() >= from[best].size()))
+			{
+				best = (int)j;
+			}
+		}
+		if(best == -1)
+		{
+			result.push_back(str[i]);
+			i++;
+			continue;
+		}
+		result.append((size_t)best < to.size() ? to[best] : "");
+		i = i + from[best].size();
+	}
+	return result;
+}
+
 // tests for trim, ltrim, rtrim
 void test_trim()
 {
@@ -53,12 +112,802 @@ void test_trim()
 	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
 }
 
+void test_inplace()
+{
+	std::string str;
+
+	std::cout << "Testing trim_inplace() ltrim_inplace() rtrim_inplace()...";
+	str = "  t t  ";
+	ltrim_inplace(str);
+	assert(str == "t t  ");
+	rtrim_inplace(str);
+	assert(str == "t t");
+	str = " \r\n\t ";
+	trim_inplace(str);
+	assert(str == "");
+	str = "\r\n\v\t this is a test \r\n\v\t";
+	trim_inplace(str, "\r\n\v\t ");
+	assert(str == "this is a test");
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing str_pad()...";
+	assert(str_pad("5", 3, "0", STR_PAD_LEFT) == "005");
+	assert(str_pad("Alien", 10) == "Alien     ");
+	assert(str_pad("Alien", 10, "-=", STR_PAD_LEFT) == "-=-=-Alien");
+	assert(str_pad("Alien", 10, "_", STR_PAD_BOTH) == "__Alien___");
+	assert(str_pad("Alien", 6, "___") == "Alien_");
+	assert(str_pad("x", 4, "abc", STR_PAD_BOTH) == "axab");
+	assert(str_pad("Alien", 3, "*") == "Alien");
+	assert(str_pad("Alien", 10, "") == "Alien");
+	str = "7";
+	str_pad_inplace(str, 4, "0", STR_PAD_LEFT);
+	assert(str == "0007");
+	std::cout << "\t\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing chained calls on temporaries...";
+	str = strtolower(trim(std::string("  Content-TYPE  ")));
+	assert(str == "content-type");
+	str = ucfirst(str_pad(rtrim(std::string("value \r\n")), 7, "."));
+	assert(str == "Value..");
+	str = str_rot13(strtoupper(ltrim(std::string("\tabc"))));
+	assert(str == "NOP");
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+}
+
+void test_numeric()
+{
+	long long i = 0;
+	double d = 0;
+
+	std::cout << "Testing is_int()...";
+	assert(is_int("12345") == true);
+	assert(is_int("-12345") == true);
+	assert(is_int("+12345") == true);
+	assert(is_int("") == false);
+	assert(is_int("-") == false);
+	assert(is_int("12a") == false);
+	assert(is_int(" 12") == false);
+	assert(is_int("1234567890123456789012345678901234567890") == true);
+	assert(is_int("-9223372036854775808", i) == true && i == LLONG_MIN);
+	assert(is_int("9223372036854775808", i) == false);
+	assert(is_int("00000000000000000000123", i) == true && i == 123);
+	std::cout << "\t\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing is_numeric()...";
+	assert(is_numeric("42") == true);
+	assert(is_numeric(" -1.5e3 ") == true);
+	assert(is_numeric(".5") == true);
+	assert(is_numeric("5.") == true);
+	assert(is_numeric(".") == false);
+	assert(is_numeric("1e") == false);
+	assert(is_numeric("0x1A") == false);
+	assert(is_numeric("") == false);
+	assert(is_numeric("12 abc") == false);
+	assert(is_numeric("-1.25e-2", d) == true && d == -0.0125);
+	assert(is_numeric("3.14159265358979323846", d) == true && d == 3.14159265358979323846);
+	std::cout << "\t\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing intval() floatval()...";
+	assert(intval("42") == 42);
+	assert(intval("  -42abc") == -42);
+	assert(intval("abc") == 0);
+	assert(intval("1e3") == 1000);
+	assert(intval("99999999999999999999") == LLONG_MAX);
+	assert(intval("-99999999999999999999") == LLONG_MIN);
+	assert(intval("42", 8) == 34);
+	assert(intval("0x1A", 16) == 26);
+	assert(floatval("1.5") == 1.5);
+	assert(floatval("-0.1e1xyz") == -1.0);
+	assert(floatval("abc") == 0.0);
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+}
+
+void test_rand()
+{
+	std::vector<int> numbers;
+	std::string bytes;
+
+	std::cout << "Testing rand() random_int()...";
+	for(int i = 0; i < 10000; i++)
+	{
+		int r = rand(-5, 5);
+		assert(r >= -5 && r <= 5);
+		r = random_int(7, 3);
+		assert(r >= 3 && r <= 7);
+	}
+	assert(rand(42, 42) == 42);
+	numbers = random_int(1, 6, 6000);
+	assert(numbers.size() == 6000);
+	int seen[7] = { 0 };
+	for(size_t i = 0; i < numbers.size(); i++)
+	{
+		assert(numbers[i] >= 1 && numbers[i] <= 6);
+		seen[numbers[i]]++;
+	}
+	for(int i = 1; i <= 6; i++)
+	{
+		assert(seen[i] > 800 && seen[i] < 1200);
+	}
+	rand(INT_MIN, INT_MAX);
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing mt_srand() repeats sequences...";
+	mt_srand(1234);
+	numbers = random_int(0, 1000000, 16);
+	bytes = random_bytes(13);
+	mt_srand(1234);
+	assert(random_int(0, 1000000, 16) == numbers);
+	assert(random_bytes(13) == bytes);
+	assert(bytes.size() == 13);
+	assert(random_bytes(0) == "");
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing shuffle() array_rand()...";
+	std::vector<std::string> array = explode(",", "a,b,c,d,e,f,g,h");
+	std::vector<std::string> shuffled = array;
+	shuffle(shuffled);
+	assert(shuffled.size() == array.size());
+	std::sort(shuffled.begin(), shuffled.end());
+	assert(shuffled == array);
+	std::vector<size_t> keys = array_rand(array, 3);
+	assert(keys.size() == 3);
+	assert(keys[0] < keys[1] && keys[1] < keys[2] && keys[2] < array.size());
+	assert(array_rand(array, 8).size() == 8);
+	assert(array_rand(array, 9).empty());
+	assert(array_rand(array, 0).empty());
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+}
+
+void test_format()
+{
+	std::string buf;
+
+	std::cout << "Testing str_format() integers...";
+	assert(str_format("%d|%5d|%-5d|%05d|%+d|%05d", 42, 42, 42, 42, 42, -3) == "42|   42|42   |00042|+42|-0003");
+	assert(str_format("%u %b %o %x %X %c", 7u, 5, 8, 255, 255, 65) == "7 101 10 ff FF A");
+	assert(str_format("%d", LLONG_MIN) == "-9223372036854775808");
+	assert(str_format("%d", "12abc") == "12");
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing str_format() floats...";
+	assert(str_format("%e|%.2e|%.3F|%g", 1.5, 12345.678, 2.5, 0.00001234) == "1.500000e+0|1.23e+4|2.500|1.234e-5");
+	assert(str_format("%.2F|%08.3F|%+.1F", 3.14159, -3.14159, 2.0) == "3.14|-003.142|+2.0");
+	assert(str_format("%d", 3.99) == "3");
+	assert(str_format("%g|%G|%s", 1e25, 2e-9, 1e25) == "1.0e+25|2.0E-9|1.0E+25");
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing str_format() strings...";
+	assert(str_format("%s|%10s|%-10s|%'*10s|%.3s", "abc", "abc", "abc", "abc", "abcdef") == "abc|       abc|abc       |*******abc|abc");
+	assert(str_format("%s %s %s", std::string("x"), 1.5, 42) == "x 1.5 42");
+	assert(str_format("%2$s %1$s %%", "world", "hello") == "hello world %");
+	assert(str_format("no args") == "no args");
+	assert(str_format("%d %d", 1) == "1 ");
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing str_format_append() reuses its buffer...";
+	buf.reserve(256);
+	const char *data = buf.data();
+	for(int i = 0; i < 1000; i++)
+	{
+		buf.clear();
+		str_format_append(buf, "id=%08d name=%-10s score=%.2F", i, "ramnet", i / 3.0);
+	}
+	assert(buf == "id=00000999 name=ramnet     score=333.00");
+	assert(buf.data() == data);
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing number_format()...";
+	assert(number_format(1234567.891) == "1,234,568");
+	assert(number_format(1234567.891, 2) == "1,234,567.89");
+	assert(number_format(1234567.891, 2, ",", ".") == "1.234.567,89");
+	assert(number_format(1.005, 2) == "1.01");
+	assert(number_format(-1234.5) == "-1,235");
+	assert(number_format(-0.4) == "0");
+	assert(number_format(999.999, 2) == "1,000.00");
+	assert(number_format(12, 3, " ", "") == "12 000");
+	buf = "total: ";
+	number_format_append(buf, 1e6);
+	assert(buf == "total: 1,000,000");
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+}
+
+void test_case()
+{
+	std::string mixed = "The Quick Brown Fox @[`{ Jumps Over The Lazy Dog 0123456789 \xe9\xc9 zZaA";
+	std::string str;
+
+	std::cout << "Testing strtoupper() strtolower()...";
+	assert(strtoupper(mixed) == "THE QUICK BROWN FOX @[`{ JUMPS OVER THE LAZY DOG 0123456789 \xe9\xc9 ZZAA");
+	assert(strtolower(mixed) == "the quick brown fox @[`{ jumps over the lazy dog 0123456789 \xe9\xc9 zzaa");
+	assert(strtoupper("") == "");
+	str = str_repeat("abcXYZ", 100);
+	strtoupper_inplace(str);
+	assert(str == str_repeat("ABCXYZ", 100));
+	strtolower_inplace(str);
+	assert(str == str_repeat("abcxyz", 100));
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing ucfirst() lcfirst()...";
+	assert(ucfirst("hello world") == "Hello world");
+	assert(lcfirst("Hello World") == "hello World");
+	assert(ucfirst("1st") == "1st");
+	assert(ucfirst("") == "");
+	assert(lcfirst("") == "");
+	str = "test";
+	ucfirst_inplace(str);
+	assert(str == "Test");
+	lcfirst_inplace(str);
+	assert(str == "test");
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing str_rot13()...";
+	assert(str_rot13("Hello, World! abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ @[`{") == "Uryyb, Jbeyq! nopqrstuvwxyzabcdefghijklm NOPQRSTUVWXYZABCDEFGHIJKLM @[`{");
+	assert(str_rot13(str_rot13(mixed)) == mixed);
+	str = mixed;
+	str_rot13_inplace(str);
+	assert(str == str_rot13(mixed));
+	std::cout << "\t\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+}
+
+void test_search()
+{
+	std::string haystack = "GET /index.html HTTP/1.1\r\nHost: www.example.com\r\nUser-Agent: libramnet\r\n\r\n";
+	std::string long_needle = "User-Agent: libramnet\r\n\r\n";
+	std::string npos_test;
+
+	std::cout << "Testing str_contains()...";
+	assert(str_contains(haystack, "Host") == true);
+	assert(str_contains(haystack, "host") == false);
+	assert(str_contains(haystack, "") == true);
+	assert(str_contains("", "x") == false);
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing strpos() stripos() strrpos()...";
+	assert(strpos(haystack, "GET") == 0);
+	assert(strpos(haystack, "\r\n") == 24);
+	assert(strpos(haystack, "\r\n", 25) == 47);
+	assert(strpos(haystack, "HOST") == std::string::npos);
+	assert(strpos(haystack, long_needle) == haystack.size() - long_needle.size());
+	assert(strpos("abc", "c", 4) == std::string::npos);
+	assert(stripos(haystack, "HOST: WWW") == 26);
+	assert(stripos(haystack, "user-agent", 30) == 49);
+	std::string big = str_repeat("x", 65530) + "Needle" + str_repeat("y", 70000) + str_repeat("LONG NEEDLE ", 4) + "!";
+	assert(stripos(big, "NEEDLE") == 65530);
+	assert(stripos(big, "needle", 65531) == 135541);
+	assert(stripos(big, "needles") == std::string::npos);
+	assert(stripos(big, str_repeat("long needle ", 4) + "!", 100) == 135536);
+	assert(stripos(big, "", 7) == 7);
+	assert(strrpos(haystack, "\r\n") == haystack.size() - 2);
+	assert(strrpos(haystack, "GET") == 0);
+	assert(strrpos(haystack, "GET", 1) == std::string::npos);
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing strpos() long periodic needles...";
+	std::string periodic = str_repeat("ab", 40) + "c";
+	assert(strpos(str_repeat("ab", 1000) + "c", periodic) == 2000 - 80);
+	assert(strpos(str_repeat("ab", 1000), periodic) == std::string::npos);
+	assert(strpos(str_repeat("a", 1000) + "b" + str_repeat("a", 40), "b" + str_repeat("a", 40)) == 1000);
+	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing substr_count()...";
+	assert(substr_count(haystack, "\r\n") == 4);
+	assert(substr_count("aaaa", "aa") == 2);
+	assert(substr_count("aaaa", "") == 0);
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing str_needle_compile()...";
+	str_needle needle = str_needle_compile(long_needle);
+	assert(strpos(haystack, needle) == strpos(haystack, long_needle));
+	assert(str_contains(haystack, needle) == true);
+	assert(str_contains("User-Agent: libramnet", needle) == false);
+	assert(substr_count(haystack + haystack, needle) == 2);
+	needle = str_needle_compile("Host");
+	assert(strpos(haystack, needle) == 26);
+	str_needle constructed{long_needle};
+	assert(strpos(haystack, constructed) == strpos(haystack, long_needle));
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+}
+
+void test_array()
+{
+	std::vector<std::string> v;
+
+	std::cout << "Testing explode() without limit...";
+	v = explode(",", "a,b,,c");
+	assert(v.size() == 4 && v[0] == "a" && v[1] == "b" && v[2] == "" && v[3] == "c");
+	v = explode("||", "this||is||a||string");
+	assert(v.size() == 4 && v[3] == "string");
+	v = explode(",", "");
+	assert(v.size() == 1 && v[0] == "");
+	v = explode(",", "a,");
+	assert(v.size() == 2 && v[1] == "");
+	assert(explode("", "abc").empty());
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing explode() positive limit...";
+	v = explode(",", "a,b,c,d", 2);
+	assert(v.size() == 2 && v[0] == "a" && v[1] == "b,c,d");
+	v = explode(",", "a,b,c,d", 0);
+	assert(v.size() == 1 && v[0] == "a,b,c,d");
+	v = explode(",", "a,b", 5);
+	assert(v.size() == 2 && v[1] == "b");
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing explode() negative limit...";
+	v = explode(",", "a,b,c,d", -1);
+	assert(v.size() == 3 && v[2] == "c");
+	v = explode(",", "a,b,c,d", -4);
+	assert(v.empty());
+	v = explode(",", "abc", -1);
+	assert(v.empty());
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing explode_next()...";
+	std::string subject = "key=value=more";
+	size_t pos = 0, seg_pos = 0, seg_len = 0, count = 0;
+	while(explode_next("=", subject, pos, seg_pos, seg_len))
+	{
+		if(count == 1) { assert(subject.substr(seg_pos, seg_len) == "value"); }
+		count++;
+	}
+	assert(count == 3 && subject.substr(seg_pos, seg_len) == "more");
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing implode()...";
+	assert(implode(", ", explode(",", "a,b,,c")) == "a, b, , c");
+	assert(implode(",", std::vector<std::string>()) == "");
+	assert(implode(",", std::vector<std::string>{ "solo" }) == "solo");
+	std::cout << "\t\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing implode() with other ranges...";
+	const char *words[] = { "GET", "/", "HTTP/1.1" };
+	assert(implode(" ", words) == "GET / HTTP/1.1");
+	assert(implode(",", std::vector<int>{ 1, -20, 300 }) == "1,-20,300");
+	assert(implode(":", std::vector<unsigned long long>{ 18446744073709551615ULL, 0 }) == "18446744073709551615:0");
+	assert(implode(" ", std::vector<double>{ 1.5, 0.1, 100 }) == "1.5 0.1 100");
+	assert(implode(" ", std::vector<double>{ 1e25, -1e-7, 1.5e25, 1e14 }) == "1.0E+25 -1.0E-7 1.5E+25 1.0E+14");
+	assert(implode(",", std::vector<int>()) == "");
+	std::istringstream numbers("4 5 6");
+	struct
+	{
+		std::istringstream &in;
+		std::istream_iterator<int> begin() const { return std::istream_iterator<int>(in); }
+		std::istream_iterator<int> end() const { return std::istream_iterator<int>(); }
+	} single_pass = { numbers };
+	assert(implode("-", single_pass) == "4-5-6");
+	assert(implodable<std::vector<int>>(0) == true);
+	assert(implodable<char[3]>(0) == false && implodable<std::string>(0) == false);
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing str_replace()...";
+	assert(str_replace("||", ",", "this||is||a||string") == "this,is,a,string");
+	assert(str_replace("", ",", "abc") == "abc");
+	count = 0;
+	assert(str_replace("a", "bb", "banana", count) == "bbbnbbnbb" && count == 3);
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+}
+
+void test_str_replace()
+{
+	std::vector<std::string> search;
+	std::vector<std::string> replace;
+	size_t count = 0;
+
+	std::cout << "Testing str_replace() with arrays...";
+	search = {"&", "<", ">"};
+	replace = {"&amp;", "&lt;", "&gt;"};
+	assert(str_replace(search, replace, "<a href=\"x&y\">") == "&lt;a href=\"x&amp;y\"&gt;");
+	assert(str_replace(search, replace, "a & b & c", count) == "a &amp; b &amp; c" && count == 2);
+	assert(str_replace(search, replace, "") == "");
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing str_replace() with arrays short replace...";
+	search = {"a", "b", ""};
+	replace = {"1"};
+	assert(str_replace(search, replace, "abcab", count) == "1c1" && count == 4);
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	// PHP replaces the pairs one after another, these are the results PHP gives
+	std::cout << "Testing str_replace() with arrays in order...";
+	search = {"<", "&"};
+	replace = {"&lt;", "&amp;"};
+	assert(str_replace(search, replace, "<b>", count) == "&amp;lt;b>" && count == 2);
+	search = {"he", "she", "hers", "his"};
+	replace = {"1", "2", "3", "4"};
+	assert(str_replace(search, replace, "ushers") == "us1rs");
+	assert(str_replace(search, replace, "hishers", count) == "41rs" && count == 2);
+	search = {"ab", "abxcde", "cd"};
+	replace = {"1", "2", "3"};
+	assert(str_replace(search, replace, "abxcdq") == "1x3q");
+	assert(str_replace(search, replace, "abxcde") == "1x3e");
+	search = {"a", "aa"};
+	replace = {"1", "2"};
+	assert(str_replace(search, replace, "aaa", count) == "111" && count == 3);
+	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	// PHP's strtr() tries the longest pair first at each position, these are the results PHP gives
+	std::cout << "Testing strtr() with arrays...";
+	search = {"Hi", "hello"};
+	replace = {"Hello", "hi"};
+	assert(strtr("Hi all, I said hello", search, replace, count) == "Hello all, I said hi" && count == 2);
+	search = {"<", "&"};
+	replace = {"&lt;", "&amp;"};
+	assert(strtr("<b>", search, replace) == "&lt;b>");
+	search = {"he", "she", "hers", "his"};
+	replace = {"1", "2", "3", "4"};
+	assert(strtr("ushers", search, replace) == "u2rs");
+	assert(strtr("hishers", search, replace, count) == "43" && count == 2);
+	search = {"ab", "abxcde", "cd"};
+	replace = {"1", "2", "3"};
+	assert(strtr("abxcdq", search, replace) == "1x3q");
+	assert(strtr("abxcde", search, replace) == "2");
+	search = {"a", "aa", "a", ""};
+	replace = {"1", "2", "3", "4"};
+	assert(strtr("aaa", search, replace, count) == "23" && count == 2);
+	assert(strtr("", search, replace) == "");
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing strtr() against a plain strtr()...";
+	search = {"he", "she", "hers", "his", "a", "aa", "", "he", std::string(300, 'a') + "b"};
+	replace = {"1", "2", "3", "4", "5", "6", "7", "8", "9"};
+	std::string subject;
+	for(int i = 0; i < 2000; i++)
+	{
+		subject.append(i % 3 == 0 ? "hishers aaa " : "ushe hera ");
+		subject.append(i % 7 == 0 ? std::string(i % 400, 'a') + "b" : "");
+	}
+	strtr_table table = strtr_compile(search, replace);
+	for(size_t length : {0, 7, 50, 600, 5000, 21000, 150000})
+	{
+		size_t compiled_count = 0;
+		std::string part = subject.substr(0, length);
+		std::string expected = strtr_reference(part, search, replace);
+		assert(strtr(part, search, replace, count) == expected);
+		assert(strtr(part, table, compiled_count) == expected && count == compiled_count);
+	}
+	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	// a long from string that keeps almost matching used to make every match read it all again
+	std::cout << "Testing strtr() on a long from string...";
+	search = {"a", std::string(2000, 'a') + "b"};
+	replace = {"x", "y"};
+	subject.assign(1 << 20, 'a');
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	assert(strtr(subject, search, replace, count) == std::string(1 << 20, 'x') && count == 1 << 20);
+	assert(strtr(subject + "b", search, replace, count) == std::string((1 << 20) - 2000, 'x') + "y" && count == (1 << 20) - 1999);
+	assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing strtr_compile() reuse...";
+	search = {"\r", "\n", "\t"};
+	replace = {"", "\\n", " "};
+	strtr_table replacer = strtr_compile(search, replace);
+	assert(strtr("line\r\n", replacer) == "line\\n");
+	assert(strtr("a\tb", replacer, count) == "a b" && count == 1);
+	assert(strtr("plain", replacer, count) == "plain" && count == 0);
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+}
+
 void test_net()
 {
+	std::cout << "Testing read_line() buffering on a socketpair...";
+	int pair[2];
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+	std::string sent = "first\r\nsecond\rstill second\n" + std::string(20000, 'x') + "\ntoolong\nlast";
+	assert(send(pair[1], sent.data(), sent.size(), 0) == (ssize_t)sent.size());
+	shutdown(pair[1], SHUT_WR);
+	std::string line;
+	assert(read_line(pair[0]) == "first");
+	assert(read_line(pair[0], line) == LINE_OK && line == "second\rstill second");
+	assert(read_line(pair[0]) == std::string(20000, 'x'));
+	assert(read_line(pair[0], line, 4) == LINE_TOO_LONG && line == "tool");
+	assert(read_line(pair[0], line, 4) == LINE_OK && line == "ong");
+	assert(read_line(pair[0], line) == LINE_OK && line == "last");
+	assert(read_line(pair[0], line) == LINE_EOF && line == "");
+	close(pair[0]);
+	close(pair[1]);
+	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing write_line() write_lines() on a socketpair...";
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+	std::vector<std::string> lines = {"two", "", "three"};
+	for(int i = 0; i < 1000; i++)
+	{
+		lines.push_back(std::to_string(i));
+	}
+	assert(write_line(pair[0], "one") == true);
+	assert(write_lines(pair[0], lines) == true);
+	assert(read_line(pair[1], line) == LINE_OK && line == "one");
+	for(const std::string &sent_line : lines)
+	{
+		assert(read_line(pair[1], line) == LINE_OK && line == sent_line);
+	}
+	assert(socket_set_nodelay(pair[0], true) == false);
+	close(pair[0]);
+	close(pair[1]);
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing socket_set_nodelay() socket_set_cork()...";
+	int tcp = socket(AF_INET, SOCK_STREAM, 0);
+	assert(socket_set_nodelay(tcp, true) == true);
+	assert(socket_set_cork(tcp, true) == true);
+	assert(socket_set_cork(tcp, false) == true);
+	close(tcp);
+	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing evloop_add() evloop_run() on socketpairs...";
+	int loop = evloop_create();
+	std::vector<int> clients;
+	std::vector<std::string> received;
+	int closed = 0;
+	for(int i = 0; i < 3; i++)
+	{
+		assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+		clients.push_back(pair[1]);
+		assert(evloop_add(loop, pair[0], [&](int sock, const std::string &request)
+		{
+			received.push_back(request);
+			assert(evloop_write_line(loop, sock, "re: " + request) == true);
+		}, [&](int sock)
+		{
+			closed++;
+			close(sock);
+		}) == true);
+	}
+	assert(evloop_add(loop, pair[0], NULL) == false);
+	for(int i = 0; i < 3; i++)
+	{
+		assert(write_lines(clients[i], {"hello " + std::to_string(i), "bye"}) == true);
+		shutdown(clients[i], SHUT_WR);
+	}
+	assert(evloop_run(loop) == true);
+	assert(received.size() == 6 && closed == 3);
+	assert(std::count(received.begin(), received.end(), "bye") == 3);
+	for(int i = 0; i < 3; i++)
+	{
+		assert(read_line(clients[i], line) == LINE_OK && line == "re: hello " + std::to_string(i));
+		close(clients[i]);
+	}
+	evloop_destroy(loop);
+
+	int queue = evloop_create(10);
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+	assert(write_line(pair[1], "early") == true);
+	assert(evloop_add(queue, pair[0], [&](int sock, const std::string &request)
+	{
+		received.push_back(request);
+		evloop_stop(queue);
+	}) == true);
+	assert(evloop_run(queue) == true && received.back() == "early");
+	assert(evloop_write_line(queue, pair[0], std::string(20, 'x')) == false);
+	assert(evloop_write_line(queue, pair[0], "fits") == true);
+	assert(evloop_remove(queue, pair[0]) == true && evloop_remove(queue, pair[0]) == false);
+	assert(read_line(pair[1], line) == LINE_OK && line == "fits");
+	evloop_destroy(queue);
+	close(pair[0]);
+	close(pair[1]);
+
+	// a socket with a lot to read gets a share of each round, not the whole round
+	int fair = evloop_create();
+	int flood[2];
+	int quiet[2];
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, flood) == 0 && socketpair(AF_UNIX, SOCK_STREAM, 0, quiet) == 0);
+	assert(write_lines(flood[1], std::vector<std::string>(10000, "xxxxxxxxx")) == true);
+	assert(write_line(quiet[1], "hello") == true);
+	int flood_lines = 0;
+	int quiet_lines = 0;
+	assert(evloop_add(fair, flood[0], [&](int sock, const std::string &request) { flood_lines++; }) == true);
+	assert(evloop_add(fair, quiet[0], [&](int sock, const std::string &request) { quiet_lines++; }) == true);
+	assert(evloop_run_once(fair, 1000) == 2);
+	assert(quiet_lines == 1 && flood_lines > 0 && flood_lines < 10000);
+	while(flood_lines < 10000)
+	{
+		assert(evloop_run_once(fair, 1000) > 0);
+	}
+	evloop_destroy(fair);
+	close(flood[0]);
+	close(flood[1]);
+	close(quiet[0]);
+	close(quiet[1]);
+
+	// a socket that waits for more keeps only the bytes it has not returned, not a whole read chunk
+	int idle = evloop_create();
+	std::vector<int> idle_pairs;
+	int idle_lines = 0;
+	size_t resident = std::stoul(explode(" ", file_get_contents("/proc/self/statm"))[1]);
+	for(int i = 0; i < 1000; i++)
+	{
+		assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+		assert(send(pair[1], "hi\npartial", i % 2 == 0 ? 3 : 10, 0) > 0);
+		assert(evloop_add(idle, pair[0], [&](int sock, const std::string &request) { idle_lines++; }) == true);
+		idle_pairs.push_back(pair[0]);
+		idle_pairs.push_back(pair[1]);
+	}
+	while(idle_lines < 1000)
+	{
+		assert(evloop_run_once(idle, 1000) > 0);
+	}
+	// 64 KiB a socket would be 16000 pages
+	assert(std::stoul(explode(" ", file_get_contents("/proc/self/statm"))[1]) < resident + 4000);
+	evloop_destroy(idle);
+	for(int sock : idle_pairs)
+	{
+		close(sock);
+	}
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing read_line() evloop_run() on separate threads...";
+	std::vector<std::thread> threads;
+	for(int t = 0; t < 8; t++)
+	{
+		threads.emplace_back([t]()
+		{
+			for(int round = 0; round < 50; round++)
+			{
+				int pair[2];
+				assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+				assert(write_lines(pair[1], {"thread " + std::to_string(t), "round " + std::to_string(round)}) == true);
+				std::string line;
+				assert(read_line(pair[0], line) == LINE_OK && line == "thread " + std::to_string(t));
+				int loop = evloop_create();
+				assert(evloop_add(loop, pair[0], [&](int sock, const std::string &request)
+				{
+					line = request;
+					evloop_stop(loop);
+				}) == true);
+				assert(evloop_run(loop) == true && line == "round " + std::to_string(round));
+				evloop_destroy(loop);
+				close(pair[0]);
+				close(pair[1]);
+			}
+		});
+	}
+	for(std::thread &thread : threads)
+	{
+		thread.join();
+	}
+	assert(read_line(-1, line) == LINE_ERROR);
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing slisten() saccept() on a local port...";
+	int listener = slisten(0);
+	assert(listener != -1 && socket_port(listener) > 0);
+	int client = sopen("127.0.0.1", socket_port(listener));
+	int server = saccept(listener);
+	assert(client != -1 && server != -1);
+	assert(write_line(client, "ping") == true && read_line(server, line) == LINE_OK && line == "ping");
+	assert(write_line(server, "pong") == true && read_line(client, line) == LINE_OK && line == "pong");
+	close(client);
+	close(server);
+	assert(slisten(socket_port(listener)) == -1);
+	close(listener);
+
+	std::vector<int> listeners = slisten_reuseport(0, 4);
+	assert(listeners.size() == 4);
+	for(int sock : listeners)
+	{
+		assert(socket_port(sock) == socket_port(listeners[0]));
+	}
+	std::vector<int> accepted(listeners.size(), 0);
+	threads.clear();
+	for(size_t i = 0; i < listeners.size(); i++)
+	{
+		threads.emplace_back([&, i]()
+		{
+			int server;
+			while((server = saccept(listeners[i])) != -1)
+			{
+				std::string request;
+				assert(read_line(server, request) == LINE_OK && write_line(server, "re: " + request) == true);
+				close(server);
+				accepted[i]++;
+			}
+		});
+	}
+	for(int i = 0; i < 64; i++)
+	{
+		client = sopen("127.0.0.1", socket_port(listeners[0]));
+		assert(write_line(client, std::to_string(i)) == true);
+		assert(read_line(client, line) == LINE_OK && line == "re: " + std::to_string(i));
+		close(client);
+	}
+	// shutting a listener down wakes the thread blocked in saccept() on it
+	for(int sock : listeners)
+	{
+		shutdown(sock, SHUT_RDWR);
+	}
+	for(std::thread &thread : threads)
+	{
+		thread.join();
+	}
+	assert(accepted[0] + accepted[1] + accepted[2] + accepted[3] == 64);
+	for(int sock : listeners)
+	{
+		close(sock);
+	}
+	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing sopen() after a plain close() of the same fd...";
+	listener = slisten(0);
+	client = sopen("127.0.0.1", socket_port(listener));
+	server = saccept(listener);
+	assert(write_lines(server, {"a", "b"}) == true);
+	assert(read_line(client, line) == LINE_OK && line == "a");
+	plain_close(client);
+	close(server);
+	int reused = sopen("127.0.0.1", socket_port(listener));
+	assert(reused == client);
+	server = saccept(listener);
+	assert(write_line(server, "fresh") == true);
+	assert(read_line(reused, line) == LINE_OK && line == "fresh");
+	close(reused);
+	close(server);
+	close(listener);
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing sopen() with timeouts on a local listener...";
+	listener = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr = {};
+	socklen_t addr_length = sizeof(addr);
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	assert(bind(listener, (struct sockaddr *)&addr, sizeof(addr)) == 0 && listen(listener, 8) == 0);
+	assert(getsockname(listener, (struct sockaddr *)&addr, &addr_length) == 0);
+	int port = ntohs(addr.sin_port);
+	int local = sopen("localhost", port, 1000, 1000);
+	assert(local != -1);
+	close(local);
+	close(listener);
+	assert(sopen("127.0.0.1", port, 1000, 1000) == -1);
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing pool_sopen() pool_release() on a local listener...";
+	listener = socket(AF_INET, SOCK_STREAM, 0);
+	addr.sin_port = 0;
+	assert(bind(listener, (struct sockaddr *)&addr, sizeof(addr)) == 0 && listen(listener, 8) == 0);
+	assert(getsockname(listener, (struct sockaddr *)&addr, &addr_length) == 0);
+	port = ntohs(addr.sin_port);
+	pool_set_limits(2, 60000);
+	int first = pool_sopen("127.0.0.1", port);
+	int second = pool_sopen("127.0.0.1", port);
+	assert(first != -1 && second != -1 && first != second);
+	assert(pool_sopen("127.0.0.1", port) == -1);
+	assert(pool_release(second) == true && pool_release(listener) == false);
+	assert(pool_sopen("127.0.0.1", port) == second);
+	assert(pool_release(second) == true);
+
+	// the server side of the idle connection goes away, so the pool opens a fresh one
+	server = accept(listener, NULL, NULL);
+	close(accept(listener, NULL, NULL));
+	int third = pool_sopen("127.0.0.1", port);
+	struct pollfd pending = {listener, POLLIN, 0};
+	assert(third != -1 && poll(&pending, 1, 1000) == 1);
+	close(accept(listener, NULL, NULL));
+	assert(pool_close(third) == true && pool_close(third) == false);
+	pool_set_limits(2, 0);
+	assert(pool_release(first) == true);
+	pool_set_limits(16, 30000);
+	pool_flush();
+	close(server);
+	close(listener);
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
 	std::cout << "Tesing gethostbyname() on localhost...";
 	assert(gethostbyname("localhost") != "localhost");
 	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
 
+	std::cout << "Testing resolve() resolve_batch() on /etc/hosts...";
+	std::vector<std::string> addresses = resolve("localhost");
+	assert(std::find(addresses.begin(), addresses.end(), "127.0.0.1") != addresses.end());
+	assert(resolve("::1") == std::vector<std::string>{"::1"});
+	assert(resolve("localhost.invalid").empty());
+	std::vector<std::vector<std::string>> batch = resolve_batch({"localhost", "127.0.0.1", "localhost.invalid"}, 3);
+	assert(batch.size() == 3 && batch[0] == addresses && batch[1] == std::vector<std::string>{"127.0.0.1"} && batch[2].empty());
+	resolver_set_ttl(0, 0);
+	assert(resolve("localhost") == addresses);
+	resolver_set_ttl(60, 5);
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
 	std::cout << "Tesing url_get_contents() on http://www.example.com...";
 	assert(url_get_contents("http://www.example.com") != "");
 	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
@@ -83,9 +932,80 @@ void test_net()
 	close(sock);
 }
 
+// a throwaway self-signed certificate and key for localhost in a new directory, made with the openssl tool.
+// returns the directory, cert.pem and key.pem are in it, or "" when openssl is missing
+std::string tls_test_keypair()
+{
+	std::string dir = trim(shell_exec("mktemp -d"));
+	int status;
+	shell_exec("openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj /CN=localhost -addext subjectAltName=DNS:localhost"
+		" -keyout " + dir + "/key.pem -out " + dir + "/cert.pem 2>&1", "", status, 60);
+	if(dir == "" || status != 0)
+	{
+		shell_exec("rm -rf " + dir);
+		return "";
+	}
+	return dir;
+}
+
+// a libtls server on the listener that writes one line to each of count connections and closes them.
+// it only speaks tls 1.2, the version libtls resumes a session from the session file on every build.
+void tls_test_server(int listener, const std::string &dir, int count)
+{
+	struct tls_config *config = tls_config_new();
+	assert(config != NULL);
+	assert(tls_config_set_keypair_file(config, (dir + "/cert.pem").c_str(), (dir + "/key.pem").c_str()) == 0);
+	assert(tls_config_set_protocols(config, TLS_PROTOCOL_TLSv1_2) == 0);
+	assert(tls_config_set_session_lifetime(config, 300) == 0);
+	struct tls *server = tls_server();
+	assert(server != NULL && tls_configure(server, config) == 0);
+	for(int i = 0; i < count; i++)
+	{
+		int sock = saccept(listener);
+		struct tls *conn = NULL;
+		assert(sock != -1 && tls_accept_socket(server, &conn, sock) == 0);
+		int ret;
+		while((ret = tls_handshake(conn)) == TLS_WANT_POLLIN || ret == TLS_WANT_POLLOUT)
+		{
+		}
+		if(ret == 0)
+		{
+			tls_write(conn, "hello\r\n", 7);
+			tls_close(conn);
+		}
+		tls_free(conn);
+		close(sock);
+	}
+	tls_free(server);
+	tls_config_free(config);
+}
+
 void test_tls()
 {
-	int sock = -1;
+	std::cout << "Testing ssl_sopen() on a loopback libtls server...";
+	std::string dir = tls_test_keypair();
+	assert(dir != "");
+	int listener = slisten(0);
+	assert(listener != -1);
+	std::thread server(tls_test_server, listener, dir, 2);
+	int sock = ssl_sopen("localhost", socket_port(listener), true, dir + "/cert.pem");
+	assert(sock != -1);
+	assert(ssl_read_line(sock) == "hello");
+	assert(ssl_session_resumed(sock) == false);
+	ssl_close(sock);
+	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing ssl_session_resumed() on a second connection...";
+	sock = ssl_sopen("localhost", socket_port(listener), true, dir + "/cert.pem");
+	assert(sock != -1);
+	assert(ssl_session_resumed(sock) == true);
+	assert(ssl_read_line(sock) == "hello");
+	ssl_close(sock);
+	server.join();
+	close(listener);
+	shell_exec("rm -rf " + dir);
+	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
 	int sock2 = -1;
 	std::cout << "Testing ssl_sopen() on www.example.com port 443...";
 	sock = ssl_sopen("www.example.com", 443, true);
@@ -113,8 +1033,34 @@ void test_tls()
 	assert(ssl_read_line(sock2) == "HTTP/1.0 200 OK");
 	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
 
+	std::cout << "Testing ssl_read_line() status on www.example.com port 443...";
+	std::string line;
+	assert(ssl_read_line(sock, line) == LINE_OK && line != "");
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
 	ssl_close(sock);
 	ssl_close(sock2);
+
+	// reconnects share the config and session file of the first connection, whether the server resumes
+	// the session depends on the server and on the tls version libtls negotiates, so it isn't asserted
+	std::cout << "Testing ssl_sopen() from 4 threads on www.example.com port 443...";
+	std::vector<std::thread> threads;
+	for(int t = 0; t < 4; t++)
+	{
+		threads.emplace_back([]()
+		{
+			int sock = ssl_sopen("www.example.com", 443, true);
+			assert(sock != -1);
+			assert(ssl_write_line(sock, "HEAD / HTTP/1.0\r\nHost: www.example.com\r\n") != false);
+			assert(ssl_read_line(sock) == "HTTP/1.0 200 OK");
+			ssl_close(sock);
+		});
+	}
+	for(std::thread &thread : threads)
+	{
+		thread.join();
+	}
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
 }
 
 void test_base64()
@@ -140,6 +1086,114 @@ void test_base64()
 	decoded = base64_decode(encoded);
 	assert(decoded == testdata);
 	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing base64 every length and tail...";
+	for(size_t i = 0; i < 100; i++)
+	{
+		testdata = random_bytes(i);
+		encoded = base64_encode(testdata);
+		assert(encoded.size() == (i + 2) / 3 * 4);
+		assert(base64_decode(encoded) == testdata);
+		assert(base64_decode(base64_encode_url(testdata)) == testdata);
+	}
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing base64_encode_url...";
+	assert(base64_encode_url("\xfb\xff\xbf") == "-_-_");
+	assert(base64_encode("\xfb\xff\xbf") == "+/+/");
+	assert(base64_encode_url("ab") == "YWI.");
+	assert(base64_decode("YWI") == "ab");
+	assert(base64_decode("YQ==YWI=") == "aab");
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing base64 streaming in uneven chunks...";
+	testdata = random_bytes(1000);
+	base64_stream stream = base64_stream_init();
+	encoded = "";
+	for(size_t i = 0; i < testdata.size(); i += 7)
+	{
+		base64_encode_update(stream, testdata.substr(i, 7), encoded);
+	}
+	base64_encode_final(stream, encoded);
+	assert(encoded == base64_encode(testdata));
+	stream = base64_stream_init();
+	decoded = "";
+	for(size_t i = 0; i < encoded.size(); i += 5)
+	{
+		assert(base64_decode_update(stream, encoded.substr(i, 5) + "\r\n", decoded));
+	}
+	assert(base64_decode_final(stream, decoded) && decoded == testdata);
+	stream = base64_stream_init();
+	decoded = "";
+	assert(base64_decode_update(stream, "YW*i", decoded) == false);
+	std::cout << "\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing base64_encode_pem() base64_encode_mime()...";
+	testdata = random_bytes(1000);
+	encoded = base64_encode_pem(testdata);
+	assert(encoded.size() == 1336 + 20 && encoded[64] == '\n' && encoded.find('\n', 65) == 129);
+	assert(str_replace("\n", "", encoded) == base64_encode(testdata));
+	assert(base64_decode_mime(encoded) == testdata);
+	encoded = base64_encode_mime(testdata);
+	assert(encoded[76] == '\n' && encoded.back() != '\n');
+	assert(base64_decode_mime(str_replace("\n", "\r\n", encoded)) == testdata);
+	assert(base64_encode_pem(random_bytes(48)).find('\n') == std::string::npos);
+	assert(base64_encode_pem("") == "" && base64_decode_mime("") == "");
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing base64_decode_into()...";
+	size_t offset;
+	assert(base64_decoded_size(control) == base64_decode(control).size() && base64_decoded_size("YWI") == 2 && base64_decoded_size("") == 0);
+	assert(base64_decode_into(control, decoded, offset) == BASE64_OK && decoded == base64_decode(control));
+	assert(base64_decode_into("YWJj*GVm", decoded, offset) == BASE64_INVALID && offset == 4 && decoded == "abc");
+	assert(base64_decode_into("YWJjZ", decoded, offset) == BASE64_INVALID && offset == 5);
+	char small[4];
+	size_t written;
+	assert(base64_decode_into("YWJjZGVm", 8, small, sizeof(small), written, offset) == BASE64_TOO_SMALL && written == 3 && offset == 4);
+	assert(base64_decode_into("YWJjZA==", 8, small, sizeof(small), written, offset) == BASE64_OK && written == 4 && memcmp(small, "abcd", 4) == 0);
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing base64_encode_file() base64_decode_file()...";
+	testdata = random_bytes(200000);
+	file_put_contents("test.tmp", testdata);
+	assert(base64_encode_file("test.tmp", "test.b64"));
+	assert(file_get_contents("test.b64") == base64_encode(testdata));
+	assert(base64_decode_file("test.b64", "test.tmp"));
+	assert(file_get_contents("test.tmp") == testdata);
+	assert(base64_encode_file("test.missing", "test.b64") == false);
+	unlink("test.tmp");
+	unlink("test.b64");
+	std::cout << "\t[\033[1;32mPASSED\033[0m]" << std::endl;
+}
+
+void test_url()
+{
+	std::string testdata;
+
+	std::cout << "Testing bin2hex() hex2bin()...";
+	assert(bin2hex(std::string("\x00\x01\xab\xff ok", 7)) == "0001abff206f6b");
+	assert(hex2bin("0001ABff206F6b") == std::string("\x00\x01\xab\xff ok", 7));
+	testdata = random_bytes(1000);
+	assert(hex2bin(bin2hex(testdata)) == testdata);
+	std::string out = "untouched";
+	assert(hex2bin("abc", out) == false && out == "");
+	assert(hex2bin("zz", out) == false && hex2bin("", out) == true);
+	std::cout << "\t\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing urlencode() rawurlencode()...";
+	assert(urlencode("a b&c=d/e?f~g.h-i_j") == "a+b%26c%3Dd%2Fe%3Ff%7Eg.h-i_j");
+	assert(rawurlencode("a b&c=d/e?f~g.h-i_j") == "a%20b%26c%3Dd%2Fe%3Ff~g.h-i_j");
+	assert(urlencode("\xc3\xa9t\xc3\xa9") == "%C3%A9t%C3%A9");
+	assert(urlencode(str_repeat("plain", 20)) == str_repeat("plain", 20));
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
+
+	std::cout << "Testing urldecode() rawurldecode()...";
+	assert(urldecode("a+b%26c%3dd") == "a b&c=d");
+	assert(rawurldecode("a+b%20c") == "a+b c");
+	assert(urldecode("100%") == "100%" && urldecode("%zz%4") == "%zz%4");
+	testdata = random_bytes(1000);
+	assert(urldecode(urlencode(testdata)) == testdata && rawurldecode(rawurlencode(testdata)) == testdata);
+	std::cout << "\t\t\t[\033[1;32mPASSED\033[0m]" << std::endl;
 }
 
 void test_process()
@@ -250,9 +1304,18 @@ void test_misc()
 int main(void)
 {
 	test_trim();
+	test_numeric();
+	test_rand();
+	test_format();
+	test_case();
+	test_inplace();
+	test_search();
+	test_array();
+	test_str_replace();
 	test_net();
 	test_tls();
 	test_base64();
+	test_url();
 	test_process();
 	test_filesystem();
 	test_misc();